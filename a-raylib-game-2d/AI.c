@@ -1,285 +1,751 @@
 #include "raylib.h"
 #include "raymath.h"
 #include <stddef.h>
+#include <float.h>
 #include <math.h>
 #include "game_defs.h"
+#include "AI.h"
+#include "rng.h"
+#include "entity_pool.h"
+#include "projectile_kernels.h"
+#include "job_system.h"
+#include "flow_field.h"
+#include "neighbour_grid.h"
 
 typedef enum {
     AI_PATROL,
     AI_CHASE,
     AI_ATTACK,
-    AI_RETREAT
+    AI_RETREAT,
+    AI_STATE_COUNT
 } AIState;
 
+// Ships and beams are packed densely by an EntityPool. Ships are referred to
+// from main.c by their pool handle, which stays stable while the ship lives.
 typedef struct {
-    Vector2 position;
-    Vector2 patrolCenter;
+    float posX[MAX_AI_SHIPS];
+    float posY[MAX_AI_SHIPS];
+    float prevX[MAX_AI_SHIPS];
+    float prevY[MAX_AI_SHIPS];
+    float patrolX[MAX_AI_SHIPS];
+    float patrolY[MAX_AI_SHIPS];
+    float rotation[MAX_AI_SHIPS];
+    float health[MAX_AI_SHIPS];
+    float shootTimer[MAX_AI_SHIPS];
+    float velX[MAX_AI_SHIPS];         // Distance per tick over the last update
+    float velY[MAX_AI_SHIPS];
+    float lodElapsed[MAX_AI_SHIPS];   // Time since the ship was last updated
+    AILodTier lodTier[MAX_AI_SHIPS];
+    AIState state[MAX_AI_SHIPS];
+    int sparse[MAX_AI_SHIPS];
+    int dense[MAX_AI_SHIPS];
+    EntityPool pool;
+} AIShipPool;
+
+typedef struct {
+    float posX[MAX_AI_BEAMS];
+    float posY[MAX_AI_BEAMS];
+    float prevX[MAX_AI_BEAMS];
+    float prevY[MAX_AI_BEAMS];
+    float velX[MAX_AI_BEAMS];
+    float velY[MAX_AI_BEAMS];
+    float lifetime[MAX_AI_BEAMS];
+    int sparse[MAX_AI_BEAMS];
+    int dense[MAX_AI_BEAMS];
+    EntityPool pool;
+} AIBeamPool;
+
+// A ship that fired this tick, recorded with its pose at the time it fired
+typedef struct {
+    float x;
+    float y;
     float rotation;
-    float health;
-    bool active;
-    AIState state;
-    float shootTimer;
-    Texture2D texture;
-    Color color;
-} AIShip;
+} AIShotCommand;
 
 typedef struct {
-    Vector2 position;
-    Vector2 velocity;
-    float lifetime;
-    bool active;
-} AIBeam;
-
-static AIShip aiShips[MAX_AI_SHIPS];
-static Texture2D aiShipTexture;
-static AIBeam aiBeams[MAX_AI_BEAMS];
-
-void InitAI(void) {
-    aiShipTexture = LoadTexture("assets/ship/enemy.png");
-    
-    for (int i = 0; i < MAX_AI_SHIPS; i++) {
-        aiShips[i].position = (Vector2){
-            GetRandomValue(-WORLD_SIZE/2, WORLD_SIZE/2),
-            GetRandomValue(-WORLD_SIZE/2, WORLD_SIZE/2)
-        };
-        aiShips[i].patrolCenter = aiShips[i].position;
-        aiShips[i].rotation = GetRandomValue(0, 360);
-        aiShips[i].health = AI_MAX_HEALTH;
-        aiShips[i].active = true;
-        aiShips[i].state = AI_PATROL;
-        aiShips[i].shootTimer = 0;
-        aiShips[i].texture = aiShipTexture;
-        aiShips[i].color = RED;
+    const Vector2* players;  // Every player still flying
+    int playerCount;
+    const FlowField* flowField;
+} AIUpdateContext;
+
+// Where the shots of one job range are being written
+typedef struct {
+    AIShotCommand* shots;
+    int count;
+} AIShotSlice;
+
+// Values a transition can test, worked out once per ship per tick
+typedef enum {
+    AI_METRIC_PLAYER_DISTANCE_SQR,
+    AI_METRIC_HEALTH,
+    AI_METRIC_COUNT
+} AIMetric;
+
+typedef struct {
+    AIMetric metric;
+    bool below;        // Taken when the metric is below threshold, otherwise above
+    float threshold;
+    AIState target;
+} AITransition;
+
+// Runs every ship of one state: transition, move, then face the player if
+// the new state wants to. ships lists dense ship indices.
+typedef void (*AIStateUpdate)(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice);
+
+#define AI_MAX_TRANSITIONS 2
+
+typedef struct {
+    AIStateUpdate update;
+    bool facesPlayer;  // Turn toward the player after moving
+    bool flocks;       // Align with and close in on neighbours, every state keeps its distance
+    int transitionCount;
+    AITransition transitions[AI_MAX_TRANSITIONS];  // First match wins
+} AIStateDef;
+
+static AIShipPool aiShips;
+static AIBeamPool aiBeams;
+// Shots recorded during the parallel update. Each job range writes into
+// its own slice [start, end) of shots, a ship fires at most once per tick
+// so the slice always has room and no two workers share one.
+static AIShotCommand shots[MAX_AI_SHIPS];
+static int rangeShotCount[MAX_AI_SHIPS];  // Indexed by range start
+static int rangeEnd[MAX_AI_SHIPS];        // Indexed by range start
+static int firedCount = 0;  // Shots of the last UpdateAI, packed to the front of shots once fired
+static int groupedShips[MAX_AI_SHIPS];    // Each range sorts its ships by state here
+// Ships at the start of the tick, sorted by cell. The steering pass walks
+// it in cell order and writes each ship's pushes before any ship moves.
+static NeighbourGrid flockGrid;
+static float separationX[MAX_AI_SHIPS];    // Push away from crowding neighbours
+static float separationY[MAX_AI_SHIPS];
+static float cohesionX[MAX_AI_SHIPS];      // Alignment and cohesion together
+static float cohesionY[MAX_AI_SHIPS];
+static int beamTargets[MAX_AI_BEAMS];      // Player each beam hit this tick, -1 for none
+
+#define AI_JOB_GRAIN 256  // Ships per job range
+
+// Ships in a tier run every period ticks, staggered by handle so each tick
+// takes an even share. Periods must be powers of two.
+static const int aiLodPeriods[AI_LOD_TIER_COUNT] = {
+    [AI_LOD_NEAR] = 1,
+    [AI_LOD_MID] = AI_LOD_MID_PERIOD,
+    [AI_LOD_FAR] = AI_LOD_FAR_PERIOD
+};
+
+static unsigned int aiTick;
+static AILodStats lodStats;
+static AILodStats rangeLodStats[MAX_AI_SHIPS];  // Indexed by range start
+
+static void RemoveAIShip(int index) {
+    int from = DespawnEntity(&aiShips.pool, index);
+    if (from == index) return;
+
+    aiShips.posX[index] = aiShips.posX[from];
+    aiShips.posY[index] = aiShips.posY[from];
+    aiShips.prevX[index] = aiShips.prevX[from];
+    aiShips.prevY[index] = aiShips.prevY[from];
+    aiShips.patrolX[index] = aiShips.patrolX[from];
+    aiShips.patrolY[index] = aiShips.patrolY[from];
+    aiShips.rotation[index] = aiShips.rotation[from];
+    aiShips.health[index] = aiShips.health[from];
+    aiShips.shootTimer[index] = aiShips.shootTimer[from];
+    aiShips.velX[index] = aiShips.velX[from];
+    aiShips.velY[index] = aiShips.velY[from];
+    aiShips.lodElapsed[index] = aiShips.lodElapsed[from];
+    aiShips.lodTier[index] = aiShips.lodTier[from];
+    aiShips.state[index] = aiShips.state[from];
+}
+
+static void RemoveAIBeam(int index) {
+    int from = DespawnEntity(&aiBeams.pool, index);
+    if (from == index) return;
+
+    aiBeams.posX[index] = aiBeams.posX[from];
+    aiBeams.posY[index] = aiBeams.posY[from];
+    aiBeams.prevX[index] = aiBeams.prevX[from];
+    aiBeams.prevY[index] = aiBeams.prevY[from];
+    aiBeams.velX[index] = aiBeams.velX[from];
+    aiBeams.velY[index] = aiBeams.velY[from];
+    aiBeams.lifetime[index] = aiBeams.lifetime[from];
+}
+
+void InitAI(int shipCount) {
+    UnloadNeighbourGrid(&flockGrid);
+    InitNeighbourGrid(&flockGrid, AI_FLOCK_RADIUS, MAX_AI_SHIPS);
+    InitEntityPool(&aiShips.pool, aiShips.sparse, aiShips.dense, MAX_AI_SHIPS);
+    firedCount = 0;
+
+    for (int n = 0; n < shipCount && n < MAX_AI_SHIPS; n++) {
+        int i = SpawnEntity(&aiShips.pool);
+        aiShips.posX[i] = GetSimRandomValue(-WORLD_SIZE/2, WORLD_SIZE/2);
+        aiShips.posY[i] = GetSimRandomValue(-WORLD_SIZE/2, WORLD_SIZE/2);
+        aiShips.prevX[i] = aiShips.posX[i];
+        aiShips.prevY[i] = aiShips.posY[i];
+        aiShips.patrolX[i] = aiShips.posX[i];
+        aiShips.patrolY[i] = aiShips.posY[i];
+        aiShips.rotation[i] = GetSimRandomValue(0, 360);
+        aiShips.health[i] = AI_MAX_HEALTH;
+        aiShips.state[i] = AI_PATROL;
+        aiShips.shootTimer[i] = 0;
+        aiShips.velX[i] = 0;
+        aiShips.velY[i] = 0;
+        aiShips.lodElapsed[i] = 0;
+        aiShips.lodTier[i] = AI_LOD_NEAR;  // Sorted into its tier on the first tick
     }
 }
 
+void UnloadAI(void) {
+    UnloadNeighbourGrid(&flockGrid);
+}
+
 void InitAIBeams(void) {
-    for (int i = 0; i < MAX_AI_BEAMS; i++) {
-        aiBeams[i].active = false;
+    InitEntityPool(&aiBeams.pool, aiBeams.sparse, aiBeams.dense, MAX_AI_BEAMS);
+}
+
+static void SpawnAIBeam(float x, float y, float rotation) {
+    int i = SpawnEntity(&aiBeams.pool);
+    if (i < 0) return;
+
+    // Calculate beam starting position at front of ship
+    float offsetDistance = AI_SHIP_SIZE * 0.75f;
+    aiBeams.posX[i] = x + cosf((rotation - 90) * DEG2RAD) * offsetDistance;
+    aiBeams.posY[i] = y + sinf((rotation - 90) * DEG2RAD) * offsetDistance;
+    aiBeams.prevX[i] = aiBeams.posX[i];
+    aiBeams.prevY[i] = aiBeams.posY[i];
+
+    // Calculate beam velocity based on ship rotation
+    float angle = (rotation - 90) * DEG2RAD;
+    aiBeams.velX[i] = cosf(angle) * AI_BEAM_SPEED * SIM_TICK_SCALE;
+    aiBeams.velY[i] = sinf(angle) * AI_BEAM_SPEED * SIM_TICK_SCALE;
+
+    aiBeams.lifetime[i] = AI_BEAM_LIFETIME;
+}
+
+void ShootAIBeam(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    if (index >= 0) {
+        SpawnAIBeam(aiShips.posX[index], aiShips.posY[index], aiShips.rotation[index]);
     }
 }
 
-void ShootAIBeam(int shipIndex) {
-    for (int i = 0; i < MAX_AI_BEAMS; i++) {
-        if (!aiBeams[i].active) {
-            Vector2 shipPos = aiShips[shipIndex].position;
-            float rotation = aiShips[shipIndex].rotation;
-            
-            // Calculate beam starting position at front of ship
-            float offsetDistance = AI_SHIP_SIZE * 0.75f;
-            aiBeams[i].position.x = shipPos.x + cosf((rotation - 90) * DEG2RAD) * offsetDistance;
-            aiBeams[i].position.y = shipPos.y + sinf((rotation - 90) * DEG2RAD) * offsetDistance;
-            
-            // Calculate beam velocity based on ship rotation
-            float angle = (rotation - 90) * DEG2RAD;
-            aiBeams[i].velocity.x = cosf(angle) * AI_BEAM_SPEED;
-            aiBeams[i].velocity.y = sinf(angle) * AI_BEAM_SPEED;
-            
-            aiBeams[i].lifetime = AI_BEAM_LIFETIME;
-            aiBeams[i].active = true;
-            break;
+static void UpdatePatrolGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice);
+static void UpdateChaseGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice);
+static void UpdateAttackGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice);
+static void UpdateRetreatGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice);
+
+static const AIStateDef aiStateTable[AI_STATE_COUNT] = {
+    [AI_PATROL] = { UpdatePatrolGroup, false, true, 1, {
+        { AI_METRIC_PLAYER_DISTANCE_SQR, true, AI_CHASE_RANGE_SQR, AI_CHASE }
+    } },
+    [AI_CHASE] = { UpdateChaseGroup, true, true, 2, {
+        { AI_METRIC_PLAYER_DISTANCE_SQR, false, AI_CHASE_GIVE_UP_RANGE_SQR, AI_PATROL },
+        { AI_METRIC_PLAYER_DISTANCE_SQR, true, AI_ATTACK_RANGE_SQR, AI_ATTACK }
+    } },
+    [AI_ATTACK] = { UpdateAttackGroup, true, false, 2, {
+        { AI_METRIC_PLAYER_DISTANCE_SQR, false, AI_ATTACK_RANGE_SQR, AI_CHASE },
+        { AI_METRIC_HEALTH, true, AI_RETREAT_HEALTH, AI_RETREAT }
+    } },
+    [AI_RETREAT] = { UpdateRetreatGroup, true, false, 1, {
+        { AI_METRIC_HEALTH, false, AI_RECOVERED_HEALTH, AI_PATROL }
+    } }
+};
+
+// The player ship i goes after is the nearest one, ties go to the lower
+// index. Without any the distance is FLT_MAX, which sends it back to
+// patrolling, and false is returned.
+static inline bool FindAITarget(const AIUpdateContext* context, int i, Vector2* target, float* distanceSqr) {
+    *distanceSqr = FLT_MAX;
+    *target = (Vector2){ aiShips.posX[i], aiShips.posY[i] };
+    for (int p = 0; p < context->playerCount; p++) {
+        float dx = aiShips.posX[i] - context->players[p].x;
+        float dy = aiShips.posY[i] - context->players[p].y;
+        if (dx*dx + dy*dy < *distanceSqr) {
+            *distanceSqr = dx*dx + dy*dy;
+            *target = context->players[p];
         }
     }
+    return context->playerCount > 0;
 }
 
-void UpdateAI(Vector2 playerPos, float deltaTime, bool* gameOver) {
-    for (int i = 0; i < MAX_AI_SHIPS; i++) {
-        if (!aiShips[i].active) continue;
+// Picks the next state of a ship from where it is before moving. Every
+// group passes its own table entry as a constant, so the compiler unrolls
+// the transition list instead of walking it per ship.
+static inline void TakeTransition(AIState state, int i, float playerDistanceSqr) {
+    const AIStateDef* def = &aiStateTable[state];
+    float metrics[AI_METRIC_COUNT] = {
+        [AI_METRIC_PLAYER_DISTANCE_SQR] = playerDistanceSqr,
+        [AI_METRIC_HEALTH] = aiShips.health[i]
+    };
 
-        aiShips[i].shootTimer -= deltaTime;
-        float distToPlayer = Vector2Distance(aiShips[i].position, playerPos);
+    for (int t = 0; t < def->transitionCount; t++) {
+        const AITransition* transition = &def->transitions[t];
+        float value = metrics[transition->metric];
+        if (transition->below ? value < transition->threshold : value > transition->threshold) {
+            aiShips.state[i] = transition->target;
+            return;
+        }
+    }
+}
+
+static inline bool IsAIShipDue(int i) {
+    unsigned int phase = aiTick + (unsigned int)GetEntityHandle(&aiShips.pool, i);
+    return (phase & (aiLodPeriods[aiShips.lodTier[i]] - 1)) == 0;
+}
+
+// How far ship i gets to move this update, in 60 Hz ticks. Ships in a
+// slower tier catch up on all the time they sat out.
+static inline float GetAIShipTickScale(int i) {
+    return aiShips.lodElapsed[i] / SIM_DT * SIM_TICK_SCALE;
+}
+
+static AILodTier GetAILodTier(float distanceSqr) {
+    if (distanceSqr < AI_LOD_NEAR_RANGE * AI_LOD_NEAR_RANGE) return AI_LOD_NEAR;
+    if (distanceSqr < AI_LOD_MID_RANGE * AI_LOD_MID_RANGE) return AI_LOD_MID;
+    return AI_LOD_FAR;
+}
+
+// Adds the boids steering worked out for ship i this tick. Every state
+// keeps its distance, only flocking states also follow their neighbours.
+// The push is capped at the ship's own speed.
+static inline void Flock(AIState state, int i, float tickScale) {
+    Vector2 steer = { separationX[i], separationY[i] };
+    if (aiStateTable[state].flocks) {
+        steer.x += cohesionX[i];
+        steer.y += cohesionY[i];
+    }
+
+    steer = Vector2Scale(steer, tickScale / SIM_TICK_SCALE);
+    steer = Vector2ClampValue(steer, 0.0f, AI_SPEED * tickScale);
+    aiShips.posX[i] += steer.x;
+    aiShips.posY[i] += steer.y;
+}
+
+// Turns the ship toward its target if the state it moved into asks for it
+static inline void FacePlayer(int i, bool targeted, Vector2 playerPos) {
+    if (!targeted || !aiStateTable[aiShips.state[i]].facesPlayer) return;
+
+    float dx = playerPos.x - aiShips.posX[i];
+    float dy = playerPos.y - aiShips.posY[i];
+    aiShips.rotation[i] = atan2f(dy, dx) * RAD2DEG + 90;
+}
+
+static void UpdatePatrolGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice) {
+    (void)shotSlice;
+
+    // Patrol in a circle around patrol center
+    for (int k = 0; k < count; k++) {
+        int i = ships[k];
+        Vector2 playerPos;
+        float playerDistanceSqr;
+        bool targeted = FindAITarget(context, i, &playerPos, &playerDistanceSqr);
+        TakeTransition(AI_PATROL, i, playerDistanceSqr);
+        float tickScale = GetAIShipTickScale(i);
+
+        float patrolAngle = aiShips.rotation[i] * DEG2RAD;
+        Vector2 targetPos = {
+            aiShips.patrolX[i] + cosf(patrolAngle) * AI_PATROL_RADIUS,
+            aiShips.patrolY[i] + sinf(patrolAngle) * AI_PATROL_RADIUS
+        };
+        Vector2 position = { aiShips.posX[i], aiShips.posY[i] };
+        position = Vector2MoveTowards(position, targetPos, AI_SPEED * tickScale);
+        aiShips.posX[i] = position.x;
+        aiShips.posY[i] = position.y;
+        aiShips.rotation[i] += AI_ROTATION_SPEED * tickScale;
+
+        Flock(AI_PATROL, i, tickScale);
+        FacePlayer(i, targeted, playerPos);
+    }
+}
+
+static void UpdateChaseGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice) {
+    (void)shotSlice;
 
-        // Add shooting logic in AI_ATTACK state
-        if (aiShips[i].state == AI_ATTACK && aiShips[i].shootTimer <= 0) {
-            ShootAIBeam(i);
-            aiShips[i].shootTimer = AI_SHOOT_COOLDOWN;
+    // Move towards player
+    for (int k = 0; k < count; k++) {
+        int i = ships[k];
+        Vector2 playerPos;
+        float playerDistanceSqr;
+        bool targeted = FindAITarget(context, i, &playerPos, &playerDistanceSqr);
+        TakeTransition(AI_CHASE, i, playerDistanceSqr);
+        float tickScale = GetAIShipTickScale(i);
+
+        // Follow the flow field around obstacles, head straight in once close.
+        // The field only leads to one player, ships after another go straight.
+        Vector2 position = { aiShips.posX[i], aiShips.posY[i] };
+        Vector2 direction;
+        if (context->flowField != NULL && targeted && IsInFlowFieldGoalCell(context->flowField, playerPos) &&
+            SampleFlowField(context->flowField, position, &direction)) {
+            position = Vector2Add(position, Vector2Scale(direction, AI_SPEED * tickScale));
+        } else {
+            position = Vector2MoveTowards(position, playerPos, AI_SPEED * tickScale);
         }
+        aiShips.posX[i] = position.x;
+        aiShips.posY[i] = position.y;
 
-        // State machine
-        switch(aiShips[i].state) {
-            case AI_PATROL:
-                if (distToPlayer < AI_CHASE_RANGE) {
-                    aiShips[i].state = AI_CHASE;
-                }
-                // Patrol in a circle around patrol center
-                {
-                    float patrolAngle = aiShips[i].rotation * DEG2RAD;
-                    Vector2 targetPos = {
-                        aiShips[i].patrolCenter.x + cosf(patrolAngle) * AI_PATROL_RADIUS,
-                        aiShips[i].patrolCenter.y + sinf(patrolAngle) * AI_PATROL_RADIUS
-                    };
-                    aiShips[i].rotation += AI_ROTATION_SPEED;
-                    aiShips[i].position = Vector2MoveTowards(
-                        aiShips[i].position, 
-                        targetPos, 
-                        AI_SPEED
-                    );
-                }
-                break;
+        Flock(AI_CHASE, i, tickScale);
+        FacePlayer(i, targeted, playerPos);
+    }
+}
 
-            case AI_CHASE:
-                if (distToPlayer > AI_CHASE_RANGE * 1.2f) {
-                    aiShips[i].state = AI_PATROL;
-                } else if (distToPlayer < AI_ATTACK_RANGE) {
-                    aiShips[i].state = AI_ATTACK;
-                }
-                // Move towards player
-                aiShips[i].position = Vector2MoveTowards(
-                    aiShips[i].position,
-                    playerPos,
-                    AI_SPEED
-                );
-                break;
-
-            case AI_ATTACK:
-                if (distToPlayer > AI_ATTACK_RANGE) {
-                    aiShips[i].state = AI_CHASE;
-                } else if (aiShips[i].health < AI_MAX_HEALTH * 0.3f) {
-                    aiShips[i].state = AI_RETREAT;
-                }
-                // Attack logic (shooting) is handled in the main game loop
-                break;
+static void UpdateAttackGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice) {
+    // Hold position and fire whenever the gun is ready
+    for (int k = 0; k < count; k++) {
+        int i = ships[k];
+        Vector2 playerPos;
+        float playerDistanceSqr;
+        bool targeted = FindAITarget(context, i, &playerPos, &playerDistanceSqr);
+        TakeTransition(AI_ATTACK, i, playerDistanceSqr);
+        float tickScale = GetAIShipTickScale(i);
 
-            case AI_RETREAT:
-                if (aiShips[i].health > AI_MAX_HEALTH * 0.5f) {
-                    aiShips[i].state = AI_PATROL;
-                }
-                // Move away from player
-                {
-                    Vector2 retreatDir = Vector2Subtract(aiShips[i].position, playerPos);
-                    retreatDir = Vector2Normalize(retreatDir);
-                    aiShips[i].position = Vector2Add(
-                        aiShips[i].position,
-                        Vector2Scale(retreatDir, AI_SPEED)
-                    );
+        if (aiShips.shootTimer[i] <= 0) {
+            shotSlice->shots[shotSlice->count++] = (AIShotCommand){
+                aiShips.posX[i], aiShips.posY[i], aiShips.rotation[i]
+            };
+            aiShips.shootTimer[i] = AI_SHOOT_COOLDOWN;
+        }
+
+        Flock(AI_ATTACK, i, tickScale);
+        FacePlayer(i, targeted, playerPos);
+    }
+}
+
+static void UpdateRetreatGroup(const int* ships, int count, const AIUpdateContext* context, AIShotSlice* shotSlice) {
+    (void)shotSlice;
+
+    // Move away from player
+    for (int k = 0; k < count; k++) {
+        int i = ships[k];
+        Vector2 playerPos;
+        float playerDistanceSqr;
+        bool targeted = FindAITarget(context, i, &playerPos, &playerDistanceSqr);
+        TakeTransition(AI_RETREAT, i, playerDistanceSqr);
+        float tickScale = GetAIShipTickScale(i);
+
+        Vector2 position = { aiShips.posX[i], aiShips.posY[i] };
+        Vector2 retreatDir = Vector2Normalize(Vector2Subtract(position, playerPos));
+        position = Vector2Add(position, Vector2Scale(retreatDir, AI_SPEED * tickScale));
+        aiShips.posX[i] = position.x;
+        aiShips.posY[i] = position.y;
+
+        Flock(AI_RETREAT, i, tickScale);
+        FacePlayer(i, targeted, playerPos);
+    }
+}
+
+// Job body, ships only touch their own slots so ranges can run on any worker.
+// The ships due this tick are grouped by state so every state runs as one
+// tight loop, the rest only wait for their turn.
+static void UpdateAIShipRange(void* context, int start, int end, int worker) {
+    (void)worker;
+    const AIUpdateContext* updateContext = context;
+    AIShotSlice shotSlice = { &shots[start], 0 };
+    AILodStats* stats = &rangeLodStats[start];
+    *stats = (AILodStats){ 0 };
+
+    // Stable counting sort, ships keep their order inside a group
+    int groupStart[AI_STATE_COUNT + 1] = { 0 };
+    for (int i = start; i < end; i++) {
+        stats->ships[aiShips.lodTier[i]]++;
+        if (!IsAIShipDue(i)) continue;
+
+        stats->updated[aiShips.lodTier[i]]++;
+        groupStart[aiShips.state[i] + 1]++;
+    }
+    for (int s = 0; s < AI_STATE_COUNT; s++) groupStart[s + 1] += groupStart[s];
+
+    int groupNext[AI_STATE_COUNT];
+    for (int s = 0; s < AI_STATE_COUNT; s++) groupNext[s] = start + groupStart[s];
+    for (int i = start; i < end; i++) {
+        if (IsAIShipDue(i)) groupedShips[groupNext[aiShips.state[i]]++] = i;
+    }
+
+    for (int s = 0; s < AI_STATE_COUNT; s++) {
+        const int* ships = &groupedShips[start + groupStart[s]];
+        int count = groupStart[s + 1] - groupStart[s];
+        if (count == 0) continue;
+
+        aiStateTable[s].update(ships, count, updateContext, &shotSlice);
+    }
+
+    // Settle the updated ships: per tick velocity for flocking, and a tier
+    // for where they ended up
+    int updated = groupStart[AI_STATE_COUNT];
+    for (int k = 0; k < updated; k++) {
+        int i = groupedShips[start + k];
+        float ticks = aiShips.lodElapsed[i] / SIM_DT;
+        aiShips.velX[i] = (aiShips.posX[i] - aiShips.prevX[i]) / ticks;
+        aiShips.velY[i] = (aiShips.posY[i] - aiShips.prevY[i]) / ticks;
+        aiShips.lodElapsed[i] = 0.0f;
+
+        Vector2 playerPos;
+        float playerDistanceSqr;
+        FindAITarget(updateContext, i, &playerPos, &playerDistanceSqr);
+        aiShips.lodTier[i] = GetAILodTier(playerDistanceSqr);
+    }
+
+    rangeShotCount[start] = shotSlice.count;
+    rangeEnd[start] = end;
+}
+
+// Job body over grid slots, so neighbouring ships are handled together.
+// Separation pushes off anything closer than AI_SEPARATION_DISTANCE,
+// alignment matches the average heading and cohesion pulls toward the
+// average position of the ships within AI_FLOCK_RADIUS.
+static void UpdateFlockingRange(void* context, int start, int end, int worker) {
+    (void)context;
+    (void)worker;
+    const NeighbourGrid* grid = &flockGrid;
+    float speed = AI_SPEED * SIM_TICK_SCALE;
+
+    for (int s = start; s < end; s++) {
+        int i = grid->ids[s];
+        if (!IsAIShipDue(i)) continue;
+
+        Vector2 self = { grid->x[s], grid->y[s] };
+
+        int neighbours[AI_FLOCK_MAX_NEIGHBOURS + 1];  // One more for the ship itself
+        int found = QueryNeighbourGrid(grid, self, AI_FLOCK_RADIUS, neighbours, AI_FLOCK_MAX_NEIGHBOURS + 1);
+
+        Vector2 separation = { 0.0f, 0.0f };
+        Vector2 heading = { 0.0f, 0.0f };
+        Vector2 center = { 0.0f, 0.0f };
+        int count = 0;
+        for (int n = 0; n < found; n++) {
+            int t = neighbours[n];
+            if (t == s) continue;
+
+            int j = grid->ids[t];
+            float dx = self.x - grid->x[t];
+            float dy = self.y - grid->y[t];
+            float distanceSqr = dx*dx + dy*dy;
+            if (distanceSqr < AI_SEPARATION_DISTANCE * AI_SEPARATION_DISTANCE) {
+                float distance = sqrtf(distanceSqr);
+                float push = 1.0f - distance / AI_SEPARATION_DISTANCE;
+                if (distance > 0.0f) {
+                    separation.x += dx / distance * push;
+                    separation.y += dy / distance * push;
+                } else {
+                    // Stacked ships split apart along a fixed axis
+                    separation.x += i < j ? -push : push;
                 }
-                break;
+            }
+            heading.x += aiShips.velX[j];
+            heading.y += aiShips.velY[j];
+            center.x += grid->x[t];
+            center.y += grid->y[t];
+            count++;
         }
 
-        // Update rotation to face movement direction or player
-        if (aiShips[i].state != AI_PATROL) {
-            Vector2 direction = Vector2Subtract(playerPos, aiShips[i].position);
-            aiShips[i].rotation = atan2f(direction.y, direction.x) * RAD2DEG + 90;
+        if (count == 0) {
+            separationX[i] = separationY[i] = 0.0f;
+            cohesionX[i] = cohesionY[i] = 0.0f;
+            continue;
         }
+
+        separationX[i] = separation.x * AI_SEPARATION_WEIGHT * speed;
+        separationY[i] = separation.y * AI_SEPARATION_WEIGHT * speed;
+        cohesionX[i] = (heading.x / count - aiShips.velX[i]) * AI_ALIGNMENT_WEIGHT +
+                       (center.x / count - self.x) / AI_FLOCK_RADIUS * AI_COHESION_WEIGHT * speed;
+        cohesionY[i] = (heading.y / count - aiShips.velY[i]) * AI_ALIGNMENT_WEIGHT +
+                       (center.y / count - self.y) / AI_FLOCK_RADIUS * AI_COHESION_WEIGHT * speed;
     }
 }
 
-void UpdateAIBeams(Vector2 playerPos, float deltaTime) {
-    for (int i = 0; i < MAX_AI_BEAMS; i++) {
-        if (aiBeams[i].active) {
-            aiBeams[i].position = Vector2Add(aiBeams[i].position, aiBeams[i].velocity);
-            aiBeams[i].lifetime -= deltaTime;
+void UpdateAI(const Vector2* players, int playerCount, const FlowField* flowField, float deltaTime) {
+    aiTick++;
+    for (int i = 0; i < aiShips.pool.count; i++) {
+        aiShips.lodElapsed[i] += deltaTime;
+    }
 
-            if (aiBeams[i].lifetime <= 0) {
-                aiBeams[i].active = false;
-                continue;
-            }
+    // Steering only reads where ships were before this tick
+    BuildNeighbourGrid(&flockGrid, aiShips.posX, aiShips.posY, aiShips.pool.count);
 
-            // Check collision with player
-            if (CheckCollisionCircles(playerPos, PLAYER_SIZE/2,
-                aiBeams[i].position, AI_BEAM_SIZE/2)) {
-                aiBeams[i].active = false;
-                // Player damage is handled in main.c
-            }
+    CopyPositions(aiShips.prevX, aiShips.prevY, aiShips.posX, aiShips.posY, aiShips.pool.count);
+    DecrementLifetimes(aiShips.shootTimer, deltaTime, aiShips.pool.count);
+
+    ParallelFor(aiShips.pool.count, AI_JOB_GRAIN, UpdateFlockingRange, NULL);
+
+    AIUpdateContext context = { players, playerCount, flowField };
+    ParallelFor(aiShips.pool.count, AI_JOB_GRAIN, UpdateAIShipRange, &context);
+
+    // Fire range by range in ship order no matter which worker ran which
+    // range, so the beam pool ends up the same as a single threaded update
+    lodStats = (AILodStats){ 0 };
+    firedCount = 0;
+    for (int start = 0; start < aiShips.pool.count; start = rangeEnd[start]) {
+        for (int s = start; s < start + rangeShotCount[start]; s++) {
+            SpawnAIBeam(shots[s].x, shots[s].y, shots[s].rotation);
+            shots[firedCount++] = shots[s];
+        }
+        for (int t = 0; t < AI_LOD_TIER_COUNT; t++) {
+            lodStats.ships[t] += rangeLodStats[start].ships[t];
+            lodStats.updated[t] += rangeLodStats[start].updated[t];
         }
     }
 }
 
-void DrawAIShips(void) {
-    for (int i = 0; i < MAX_AI_SHIPS; i++) {
-        if (!aiShips[i].active) continue;
+AILodStats GetAILodStats(void) {
+    return lodStats;
+}
 
-        // Draw health bar
-        Vector2 healthBarPos = {
-            aiShips[i].position.x - AI_SHIP_SIZE/2,
-            aiShips[i].position.y - AI_SHIP_SIZE
-        };
-        float healthPercentage = aiShips[i].health / AI_MAX_HEALTH;
-        DrawRectangle(
-            healthBarPos.x,
-            healthBarPos.y,
-            AI_SHIP_SIZE,
-            5,
-            RED
-        );
-        DrawRectangle(
-            healthBarPos.x,
-            healthBarPos.y,
-            AI_SHIP_SIZE * healthPercentage,
-            5,
-            GREEN
-        );
-
-        // Draw ship
-        Rectangle sourceRec = {0, 0, aiShipTexture.width, aiShipTexture.height};
-        Rectangle destRec = {
-            aiShips[i].position.x - AI_SHIP_SIZE/2,
-            aiShips[i].position.y - AI_SHIP_SIZE/2,
-            AI_SHIP_SIZE,
-            AI_SHIP_SIZE
-        };
-        DrawTexturePro(
-            aiShips[i].texture,
-            sourceRec,
-            destRec,
-            (Vector2){AI_SHIP_SIZE/2, AI_SHIP_SIZE/2},
-            aiShips[i].rotation,
-            aiShips[i].color
-        );
+int GetAIStateRegions(StateRegion* regions, int maxRegions) {
+    // The flocking grid, the shot list and the per-range arrays only live
+    // within one UpdateAI
+    StateRegion own[] = {
+        { &aiShips, sizeof(aiShips) },
+        { &aiBeams, sizeof(aiBeams) },
+        { &aiTick, sizeof(aiTick) },
+        { &lodStats, sizeof(lodStats) }
+    };
+    int count = sizeof(own) / sizeof(own[0]);
+    if (count > maxRegions) return -1;
+    for (int r = 0; r < count; r++) {
+        regions[r] = own[r];
+    }
+    return count;
+}
+
+void RestoreAIState(void) {
+    // The pools point into their own arrays, which are elsewhere in another process
+    aiShips.pool.sparse = aiShips.sparse;
+    aiShips.pool.dense = aiShips.dense;
+    aiBeams.pool.sparse = aiBeams.sparse;
+    aiBeams.pool.dense = aiBeams.dense;
+    firedCount = 0;
+}
+
+int GetAIShots(Vector2* positions, int maxShots) {
+    int count = firedCount < maxShots ? firedCount : maxShots;
+    for (int s = 0; s < count; s++) {
+        positions[s] = (Vector2){ shots[s].x, shots[s].y };
     }
+    return firedCount;
 }
 
-void DrawAIBeams(void) {
-    for (int i = 0; i < MAX_AI_BEAMS; i++) {
-        if (aiBeams[i].active) {
-            DrawCircle(aiBeams[i].position.x, aiBeams[i].position.y, AI_BEAM_SIZE/2, RED);
+int UpdateAIBeams(const Vector2* players, int playerCount, int* playerHits, float deltaTime) {
+    int hits = 0;
+    for (int p = 0; p < playerCount; p++) {
+        playerHits[p] = 0;
+    }
+
+    CopyPositions(aiBeams.prevX, aiBeams.prevY, aiBeams.posX, aiBeams.posY, aiBeams.pool.count);
+
+    unsigned int alive[ALIVE_MASK_WORDS(MAX_AI_BEAMS)];
+    UpdateProjectiles(aiBeams.posX, aiBeams.posY, aiBeams.velX, aiBeams.velY,
+                      aiBeams.lifetime, deltaTime, aiBeams.pool.count, alive);
+
+    // Whole steps are tested against every player, so no beam flies
+    // through. A beam reaching two players in one step hits the lower index.
+    unsigned int hit[ALIVE_MASK_WORDS(MAX_AI_BEAMS)];
+    for (int i = 0; i < aiBeams.pool.count; i++) {
+        beamTargets[i] = -1;
+    }
+    for (int p = 0; p < playerCount; p++) {
+        SweepProjectiles(aiBeams.posX, aiBeams.posY, aiBeams.velX, aiBeams.velY, aiBeams.pool.count,
+                         players[p].x, players[p].y, PLAYER_SIZE/2 + AI_BEAM_SIZE/2, hit);
+        for (int i = 0; i < aiBeams.pool.count; i++) {
+            if (beamTargets[i] < 0 && IsProjectileHit(hit, i)) beamTargets[i] = p;
         }
     }
+
+    // Walk backwards so a beam swapped in from the end has already been checked
+    for (int i = aiBeams.pool.count - 1; i >= 0; i--) {
+        if (!IsProjectileAlive(alive, i)) {
+            RemoveAIBeam(i);
+        } else if (beamTargets[i] >= 0) {
+            playerHits[beamTargets[i]]++;  // Player damage is handled in game.c
+            RemoveAIBeam(i);
+            hits++;
+        }
+    }
+
+    return hits;
 }
 
-void DamageAIShip(int index, float damage) {
-    if (!aiShips[index].active) return;
-    
-    aiShips[index].health -= damage;
-    if (aiShips[index].health <= 0) {
-        aiShips[index].active = false;
-    } else if (aiShips[index].health < AI_MAX_HEALTH * 0.3f) {
-        aiShips[index].state = AI_RETREAT;
+bool DamageAIShip(int handle, float damage) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    if (index < 0) return false;
+
+    aiShips.health[index] -= damage;
+    if (aiShips.health[index] <= 0) {
+        RemoveAIShip(index);
+        return true;
     }
+    if (aiShips.health[index] < AI_RETREAT_HEALTH) {
+        aiShips.state[index] = AI_RETREAT;
+    }
+    return false;
 }
 
-bool CanAIShipShoot(int index) {
-    return aiShips[index].active && 
-           aiShips[index].state == AI_ATTACK && 
-           aiShips[index].shootTimer <= 0;
+bool CanAIShipShoot(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    return index >= 0 &&
+           aiShips.state[index] == AI_ATTACK &&
+           aiShips.shootTimer[index] <= 0;
 }
 
-void ResetAIShootTimer(int index) {
-    aiShips[index].shootTimer = AI_SHOOT_COOLDOWN;
+void ResetAIShootTimer(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    if (index >= 0) {
+        aiShips.shootTimer[index] = AI_SHOOT_COOLDOWN;
+    }
 }
 
-Vector2 GetAIShipPosition(int index) {
-    return aiShips[index].position;
+int GetAIShipCount(void) {
+    return aiShips.pool.count;
 }
 
-float GetAIShipRotation(int index) {
-    return aiShips[index].rotation;
+int GetAIShipHandle(int index) {
+    return GetEntityHandle(&aiShips.pool, index);
 }
 
-void UnloadAI(void) {
-    UnloadTexture(aiShipTexture);
+bool IsAIShipActive(int handle) {
+    return GetEntityIndex(&aiShips.pool, handle) >= 0;
 }
 
-bool IsAIBeamActive(int index) {
-    if (index >= 0 && index < MAX_AI_BEAMS) {
-        return aiBeams[index].active;
+Vector2 GetAIShipPosition(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    if (index >= 0) {
+        return (Vector2){ aiShips.posX[index], aiShips.posY[index] };
     }
-    return false;
+    return (Vector2){0, 0};
+}
+
+float GetAIShipRotation(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    return index >= 0 ? aiShips.rotation[index] : 0.0f;
+}
+
+Vector2 GetAIShipPreviousPosition(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    if (index >= 0) {
+        return (Vector2){ aiShips.prevX[index], aiShips.prevY[index] };
+    }
+    return (Vector2){0, 0};
+}
+
+float GetAIShipHealth(int handle) {
+    int index = GetEntityIndex(&aiShips.pool, handle);
+    return index >= 0 ? aiShips.health[index] : 0.0f;
+}
+
+int GetAIBeamCount(void) {
+    return aiBeams.pool.count;
+}
+
+bool IsAIBeamActive(int index) {
+    return index >= 0 && index < aiBeams.pool.count;
 }
 
 Vector2 GetAIBeamPosition(int index) {
-    if (index >= 0 && index < MAX_AI_BEAMS) {
-        return aiBeams[index].position;
+    if (index >= 0 && index < aiBeams.pool.count) {
+        return (Vector2){ aiBeams.posX[index], aiBeams.posY[index] };
     }
     return (Vector2){0, 0};
-} 
\ No newline at end of file
+}
+
+Vector2 GetAIBeamPreviousPosition(int index) {
+    if (index >= 0 && index < aiBeams.pool.count) {
+        return (Vector2){ aiBeams.prevX[index], aiBeams.prevY[index] };
+    }
+    return (Vector2){0, 0};
+}
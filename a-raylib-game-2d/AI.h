@@ -2,22 +2,56 @@
 #define AI_H
 
 #include "raylib.h"
+#include "flow_field.h"
+#include "snapshot.h"
+
+// Distant ships are updated less often, see AI_LOD_* in game_defs.h
+typedef enum {
+    AI_LOD_NEAR,
+    AI_LOD_MID,
+    AI_LOD_FAR,
+    AI_LOD_TIER_COUNT
+} AILodTier;
+
+// Ships per tier during the last UpdateAI, and how many of them ran
+typedef struct {
+    int ships[AI_LOD_TIER_COUNT];
+    int updated[AI_LOD_TIER_COUNT];
+} AILodStats;
 
 // Function declarations
-void InitAI(void);
-void UpdateAI(Vector2 playerPos, float deltaTime, bool* gameOver);
-void DrawAIShips(void);
-void DamageAIShip(int index, float damage);
-bool CanAIShipShoot(int index);
-void ResetAIShootTimer(int index);
-Vector2 GetAIShipPosition(int index);
-float GetAIShipRotation(int index);
+void InitAI(int shipCount);
 void UnloadAI(void);
+// Every ship goes after the nearest of players, the ones still flying.
+// Chasing ships follow flowField around obstacles when it leads to their
+// player, it may be NULL.
+void UpdateAI(const Vector2* players, int playerCount, const FlowField* flowField, float deltaTime);
+AILodStats GetAILodStats(void);
+// Where the ships that fired during the last UpdateAI were, in firing order.
+// Writes up to maxShots and returns how many ships fired.
+int GetAIShots(Vector2* positions, int maxShots);
+// Snapshot support, see GetGameStateRegions
+int GetAIStateRegions(StateRegion* regions, int maxRegions);
+void RestoreAIState(void);
+// Ships are addressed by stable handles, iterate them with GetAIShipHandle
+// Returns true if the damage destroyed the ship
+bool DamageAIShip(int handle, float damage);
+bool CanAIShipShoot(int handle);
+void ResetAIShootTimer(int handle);
+int GetAIShipCount(void);
+int GetAIShipHandle(int index);
+bool IsAIShipActive(int handle);
+Vector2 GetAIShipPosition(int handle);
+float GetAIShipRotation(int handle);
+Vector2 GetAIShipPreviousPosition(int handle);  // Where it was before the last tick, for drawing
+float GetAIShipHealth(int handle);
 void InitAIBeams(void);
-void UpdateAIBeams(Vector2 playerPos, float deltaTime);
-void DrawAIBeams(void);
-void ShootAIBeam(int shipIndex);
+// Writes the beams that hit each player to playerHits and returns the total
+int UpdateAIBeams(const Vector2* players, int playerCount, int* playerHits, float deltaTime);
+void ShootAIBeam(int handle);
+int GetAIBeamCount(void);
 bool IsAIBeamActive(int index);
 Vector2 GetAIBeamPosition(int index);
+Vector2 GetAIBeamPreviousPosition(int index);
 
 #endif // AI_H 
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "assets.h"
+#include <pthread.h>
+#include <string.h>
+
+// The loader threads only touch an entry while it is DECODING, the main
+// thread only reads the decoded data once it is DECODED.
+typedef enum {
+    ASSET_FREE,
+    ASSET_QUEUED,
+    ASSET_DECODING,
+    ASSET_DECODED,  // Waiting for the main thread to finish it
+    ASSET_READY,
+    ASSET_FAILED
+} AssetState;
+
+typedef struct {
+    AssetState state;
+    AssetType type;
+    int refCount;  // Released entries still decoding are dropped once decoded
+    char path[ASSET_PATH_LENGTH];
+    Image image;
+    Wave wave;
+    Texture2D texture;
+    Sound sound;
+} AssetEntry;
+
+static AssetEntry entries[MAX_ASSETS];
+static int batchRequested = 0;  // Loads since the cache was last idle, for progress
+static int batchDone = 0;
+
+static pthread_t threads[ASSET_LOADER_THREADS];
+static int threadCount = 0;
+static pthread_mutex_t assetLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t decodedCond = PTHREAD_COND_INITIALIZER;
+static bool quitting = false;
+
+static AssetEntry* GetEntry(AssetHandle handle) {
+    if (handle <= ASSET_NONE || handle > MAX_ASSETS) return NULL;
+    AssetEntry* entry = &entries[handle - 1];
+    return entry->state == ASSET_FREE ? NULL : entry;
+}
+
+// Pure file decoding, safe to run on any thread
+static void DecodeAsset(AssetEntry* entry) {
+    if (entry->type == ASSET_SOUND) {
+        entry->wave = LoadWave(entry->path);
+    } else {
+        entry->image = LoadImage(entry->path);
+    }
+}
+
+static bool IsDecoded(const AssetEntry* entry) {
+    return entry->type == ASSET_SOUND ? IsWaveReady(entry->wave) : IsImageReady(entry->image);
+}
+
+static void UnloadEntry(AssetEntry* entry) {
+    if (entry->state == ASSET_DECODED) {
+        if (entry->type == ASSET_SOUND) UnloadWave(entry->wave);
+        else UnloadImage(entry->image);
+    } else if (entry->state == ASSET_READY) {
+        if (entry->type == ASSET_IMAGE) UnloadImage(entry->image);
+        else if (entry->type == ASSET_TEXTURE) UnloadTexture(entry->texture);
+        else UnloadSound(entry->sound);
+    }
+    *entry = (AssetEntry){ 0 };
+}
+
+static int NextQueuedEntry(void) {
+    for (int i = 0; i < MAX_ASSETS; i++) {
+        if (entries[i].state == ASSET_QUEUED) return i;
+    }
+    return -1;
+}
+
+static void* LoaderMain(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&assetLock);
+    while (!quitting) {
+        int i = NextQueuedEntry();
+        if (i < 0) {
+            pthread_cond_wait(&workCond, &assetLock);
+            continue;
+        }
+
+        entries[i].state = ASSET_DECODING;
+        pthread_mutex_unlock(&assetLock);
+
+        DecodeAsset(&entries[i]);
+
+        pthread_mutex_lock(&assetLock);
+        entries[i].state = ASSET_DECODED;
+        pthread_cond_broadcast(&decodedCond);
+    }
+    pthread_mutex_unlock(&assetLock);
+    return NULL;
+}
+
+void InitAssets(void) {
+    UnloadAssets();
+
+    // Without threads the main thread decodes in UpdateAssets
+    quitting = false;
+    for (int t = 0; t < ASSET_LOADER_THREADS; t++) {
+        if (pthread_create(&threads[threadCount], NULL, LoaderMain, NULL) == 0) threadCount++;
+    }
+}
+
+void UnloadAssets(void) {
+    if (threadCount > 0) {
+        pthread_mutex_lock(&assetLock);
+        quitting = true;
+        pthread_cond_broadcast(&workCond);
+        pthread_mutex_unlock(&assetLock);
+
+        for (int t = 0; t < threadCount; t++) {
+            pthread_join(threads[t], NULL);
+        }
+        threadCount = 0;
+    }
+
+    for (int i = 0; i < MAX_ASSETS; i++) {
+        UnloadEntry(&entries[i]);
+    }
+    batchRequested = 0;
+    batchDone = 0;
+}
+
+AssetHandle RequestAsset(AssetType type, const char* path) {
+    if (strlen(path) >= ASSET_PATH_LENGTH) return ASSET_NONE;
+
+    pthread_mutex_lock(&assetLock);
+    int slot = -1;
+    for (int i = 0; i < MAX_ASSETS; i++) {
+        AssetEntry* entry = &entries[i];
+        if (entry->state == ASSET_FREE) {
+            if (slot < 0) slot = i;
+        } else if (entry->type == type && strcmp(entry->path, path) == 0) {
+            entry->refCount++;
+            pthread_mutex_unlock(&assetLock);
+            return i + 1;
+        }
+    }
+
+    if (slot >= 0) {
+        entries[slot] = (AssetEntry){ .state = ASSET_QUEUED, .type = type, .refCount = 1 };
+        strcpy(entries[slot].path, path);
+        batchRequested++;
+        pthread_cond_signal(&workCond);
+    } else {
+        TraceLog(LOG_WARNING, "ASSETS: Cache full, could not load %s", path);
+    }
+    pthread_mutex_unlock(&assetLock);
+    return slot + 1;
+}
+
+void ReleaseAsset(AssetHandle handle) {
+    pthread_mutex_lock(&assetLock);
+    AssetEntry* entry = GetEntry(handle);
+    if (entry != NULL && --entry->refCount <= 0) {
+        if (entry->state == ASSET_QUEUED) {
+            batchDone++;
+            UnloadEntry(entry);
+        } else if (entry->state != ASSET_DECODING && entry->state != ASSET_DECODED) {
+            UnloadEntry(entry);
+        }
+    }
+    pthread_mutex_unlock(&assetLock);
+}
+
+// Creates the GPU or audio resource, or drops the entry if nobody wants it anymore
+static void FinishAsset(AssetEntry* entry) {
+    batchDone++;
+    if (entry->refCount <= 0) {
+        UnloadEntry(entry);
+        return;
+    }
+
+    if (!IsDecoded(entry)) {
+        TraceLog(LOG_WARNING, "ASSETS: Failed to load %s", entry->path);
+        entry->state = ASSET_FAILED;
+        return;
+    }
+
+    if (entry->type == ASSET_TEXTURE) {
+        entry->texture = LoadTextureFromImage(entry->image);
+        UnloadImage(entry->image);
+        entry->image = (Image){ 0 };
+    } else if (entry->type == ASSET_SOUND) {
+        entry->sound = LoadSoundFromWave(entry->wave);
+        UnloadWave(entry->wave);
+        entry->wave = (Wave){ 0 };
+    }
+    entry->state = ASSET_READY;
+}
+
+bool UpdateAssets(void) {
+    pthread_mutex_lock(&assetLock);
+    bool pending = false;
+    for (int i = 0; i < MAX_ASSETS; i++) {
+        AssetEntry* entry = &entries[i];
+        if (entry->state == ASSET_QUEUED && threadCount == 0) {
+            entry->state = ASSET_DECODING;
+            pthread_mutex_unlock(&assetLock);
+            DecodeAsset(entry);
+            pthread_mutex_lock(&assetLock);
+            entry->state = ASSET_DECODED;
+        }
+
+        if (entry->state == ASSET_DECODED) {
+            FinishAsset(entry);
+        } else if (entry->state == ASSET_QUEUED || entry->state == ASSET_DECODING) {
+            pending = true;
+        }
+    }
+
+    if (!pending) {
+        batchRequested = 0;
+        batchDone = 0;
+    }
+    pthread_mutex_unlock(&assetLock);
+    return !pending;
+}
+
+void WaitForAssets(void) {
+    while (!UpdateAssets()) {
+        pthread_mutex_lock(&assetLock);
+        bool decoded = false;
+        while (!decoded) {
+            for (int i = 0; i < MAX_ASSETS && !decoded; i++) {
+                decoded = entries[i].state == ASSET_DECODED;
+            }
+            if (!decoded) pthread_cond_wait(&decodedCond, &assetLock);
+        }
+        pthread_mutex_unlock(&assetLock);
+    }
+}
+
+float GetAssetProgress(void) {
+    pthread_mutex_lock(&assetLock);
+    float progress = batchRequested > 0 ? (float)batchDone / batchRequested : 1.0f;
+    pthread_mutex_unlock(&assetLock);
+    return progress;
+}
+
+bool IsAssetReady(AssetHandle handle) {
+    pthread_mutex_lock(&assetLock);
+    AssetEntry* entry = GetEntry(handle);
+    bool ready = entry != NULL && (entry->state == ASSET_READY || entry->state == ASSET_FAILED);
+    pthread_mutex_unlock(&assetLock);
+    return ready;
+}
+
+// Ready entries are only changed by the main thread, no lock needed to read them
+Image GetAssetImage(AssetHandle handle) {
+    AssetEntry* entry = GetEntry(handle);
+    return entry != NULL && entry->state == ASSET_READY ? entry->image : (Image){ 0 };
+}
+
+Texture2D GetAssetTexture(AssetHandle handle) {
+    AssetEntry* entry = GetEntry(handle);
+    return entry != NULL && entry->state == ASSET_READY ? entry->texture : (Texture2D){ 0 };
+}
+
+Sound GetAssetSound(AssetHandle handle) {
+    AssetEntry* entry = GetEntry(handle);
+    return entry != NULL && entry->state == ASSET_READY ? entry->sound : (Sound){ 0 };
+}
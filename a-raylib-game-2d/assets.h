@@ -0,0 +1,49 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+// Asset cache. Files are decoded on loader threads, and whatever needs the
+// GPU or the audio device is created from the decoded data on the main
+// thread by UpdateAssets. Requesting a path that is already cached shares
+// the entry and adds a reference, the entry goes away with the last one.
+
+#define MAX_ASSETS 32
+#define ASSET_LOADER_THREADS 2
+#define ASSET_PATH_LENGTH 128
+#define ASSET_NONE 0  // Handle that never refers to an asset
+
+typedef enum {
+    ASSET_IMAGE,    // Kept in CPU memory, for packing into an atlas
+    ASSET_TEXTURE,  // Uploaded to the GPU, the image is dropped
+    ASSET_SOUND
+} AssetType;
+
+typedef int AssetHandle;
+
+// Starts the loader threads, call after InitWindow and InitAudioDevice
+void InitAssets(void);
+// Stops the loader threads and unloads everything still cached
+void UnloadAssets(void);
+
+// Queues path for loading, or shares the entry already loaded or queued for
+// it. Returns ASSET_NONE if the cache is full.
+AssetHandle RequestAsset(AssetType type, const char* path);
+void ReleaseAsset(AssetHandle handle);
+
+// Finishes decoded assets on the main thread, call once a frame. Returns
+// true once nothing is left in flight.
+bool UpdateAssets(void);
+// Blocks until every requested asset is ready or failed
+void WaitForAssets(void);
+// Share of the assets requested since the cache was last idle that are done
+float GetAssetProgress(void);
+
+// Failed loads are ready too, and hand out empty resources
+bool IsAssetReady(AssetHandle handle);
+Image GetAssetImage(AssetHandle handle);
+Texture2D GetAssetTexture(AssetHandle handle);
+Sound GetAssetSound(AssetHandle handle);
+
+#endif // ASSETS_H
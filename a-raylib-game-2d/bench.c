@@ -0,0 +1,187 @@
+// Headless benchmark for the Space Collector simulation.
+// Usage: ./bench [ticks] [asteroidsPerChunk] [coinsPerChunk] [aiShips] [seed] [grid|brute] [threads]
+//        ./bench replay <file> [threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "game.h"
+#include "spatial_hash.h"
+#include "job_system.h"
+#include "replay.h"
+#include "snapshot.h"
+
+// Count heap allocations by wrapping the glibc allocator
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static long long allocCount = 0;
+static long long allocBytes = 0;
+
+void* malloc(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocCount++;
+    allocBytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+static double GetNanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Scripted pilot: turns every half second, always firing
+static unsigned int ScriptedInput(long long tick) {
+    static const unsigned int directions[] = {
+        INPUT_UP, INPUT_UP | INPUT_RIGHT, INPUT_RIGHT, INPUT_DOWN | INPUT_RIGHT,
+        INPUT_DOWN, INPUT_DOWN | INPUT_LEFT, INPUT_LEFT, INPUT_UP | INPUT_LEFT
+    };
+    return directions[(tick / (SIM_TICK_RATE / 2)) % 8] | INPUT_FIRE;
+}
+
+// FNV-1a over the state the player can see, two runs that behave the
+// same print the same hash
+static unsigned long long HashBytes(unsigned long long hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static unsigned long long HashGameState(void) {
+    const Player* player = GetPlayer(0);
+    const CoinPool* coins = GetCoins();
+    const AsteroidPool* asteroids = GetAsteroids();
+    int counts[] = { GetScore(), coins->count, asteroids->count, GetAIShipCount() };
+
+    unsigned long long hash = 1469598103934665603ULL;
+    hash = HashBytes(hash, &player->position, sizeof(player->position));
+    hash = HashBytes(hash, &player->health, sizeof(player->health));
+    hash = HashBytes(hash, counts, sizeof(counts));
+    hash = HashBytes(hash, coins->posX, sizeof(float) * coins->count);
+    hash = HashBytes(hash, coins->posY, sizeof(float) * coins->count);
+    hash = HashBytes(hash, asteroids->posX, sizeof(float) * asteroids->count);
+    hash = HashBytes(hash, asteroids->posY, sizeof(float) * asteroids->count);
+    return hash;
+}
+
+int main(int argc, char** argv) {
+    GameConfig config = GetDefaultGameConfig();
+    long long ticks = 10000;
+    Replay replay = { 0 };
+    bool playback = argc > 2 && strcmp(argv[1], "replay") == 0;
+
+    if (playback) {
+        // Plays a recorded session back as fast as it will go
+        if (!LoadReplay(&replay, argv[2])) {
+            fprintf(stderr, "Could not load replay %s\n", argv[2]);
+            return 1;
+        }
+        config = replay.info.config;
+        ticks = replay.info.ticks;
+        if (argc > 3) config.workerCount = atoi(argv[3]);
+    } else {
+        if (argc > 1) ticks = atoll(argv[1]);
+        if (argc > 2) config.asteroidsPerChunk = atoi(argv[2]);
+        if (argc > 3) config.coinsPerChunk = atoi(argv[3]);
+        if (argc > 4) config.aiShipCount = atoi(argv[4]);
+        if (argc > 5) config.seed = (unsigned int)strtoul(argv[5], NULL, 10);
+        if (argc > 6 && strcmp(argv[6], "brute") == 0) SetSpatialHashEnabled(false);
+        if (argc > 7) config.workerCount = atoi(argv[7]);
+    }
+
+    InitGame(config);
+
+    long long setupAllocs = allocCount;
+    long long setupBytes = allocBytes;
+    int resets = 0;
+
+    double start = GetNanoseconds();
+    if (playback) {
+        unsigned int input;
+        ReplayStep step;
+        while ((step = NextReplayStep(&replay, &input)) != REPLAY_STEP_END) {
+            if (step == REPLAY_STEP_RESET) {
+                ResetGame();
+                resets++;
+                continue;
+            }
+            SavePreviousState();
+            UpdateGame(input, SIM_DT);
+            ConsumeGameEvents();
+        }
+    } else {
+        for (long long t = 0; t < ticks; t++) {
+            SavePreviousState();
+            UpdateGame(ScriptedInput(t), SIM_DT);
+            ConsumeGameEvents();
+
+            if (IsGameOver()) {
+                ResetGame();
+                resets++;
+            }
+        }
+    }
+    double elapsed = GetNanoseconds() - start;
+
+    // Read the counters before printf allocates its stdout buffer
+    long long tickAllocs = allocCount - setupAllocs;
+    long long tickBytes = allocBytes - setupBytes;
+
+    // Snapshot the final state and put it straight back, the first capture
+    // allocates the buffer so the second one is timed
+    Snapshot snapshot = { 0 };
+    CaptureSnapshot(&snapshot);
+    double snapshotStart = GetNanoseconds();
+    CaptureSnapshot(&snapshot);
+    double captureTime = GetNanoseconds() - snapshotStart;
+    snapshotStart = GetNanoseconds();
+    RestoreSnapshot(&snapshot);
+    double restoreTime = GetNanoseconds() - snapshotStart;
+
+    GameStats stats = GetGameStats();
+    printf("ticks:             %lld (%d Hz)\n", stats.ticks, SIM_TICK_RATE);
+    printf("entities:          %d asteroids, %d coins, %d AI ships\n",
+        GetAsteroids()->count, GetCoins()->count, config.aiShipCount);
+    printf("broad phase:       %s\n", IsSpatialHashEnabled() ? "grid" : "brute force");
+    printf("job workers:       %d\n", GetJobWorkerCount());
+    printf("ns/tick:           %.0f\n", elapsed / (ticks > 0 ? ticks : 1));
+    printf("allocations:       %lld during ticks (%lld bytes), %lld at setup\n",
+        tickAllocs, tickBytes, setupAllocs);
+    printf("collision queries: %lld\n", stats.collisionQueries);
+    printf("collision hits:    %lld\n", stats.collisionHits);
+    printf("flow field:        %lld builds, %lld updates\n", stats.flowFieldBuilds, stats.flowFieldUpdates);
+    printf("asteroid physics:  %lld contacts, %lld fragments spawned\n",
+        stats.asteroidContacts, stats.asteroidFragments);
+    AILodStats lod = GetAILodStats();
+    double tickCount = stats.ticks > 0 ? (double)stats.ticks : 1.0;
+    printf("AI updates/tick:   %.0f near, %.0f mid, %.0f far (last tick %d/%d/%d ships)\n",
+        stats.aiShipUpdates[AI_LOD_NEAR] / tickCount,
+        stats.aiShipUpdates[AI_LOD_MID] / tickCount,
+        stats.aiShipUpdates[AI_LOD_FAR] / tickCount,
+        lod.ships[AI_LOD_NEAR], lod.ships[AI_LOD_MID], lod.ships[AI_LOD_FAR]);
+    WorldStreamStats world = GetWorldStreamStats();
+    printf("world chunks:      %lld loaded, %lld prefetched, %lld stalls, %d records, %d stored\n",
+        world.chunksLoaded, world.prefetchHits, world.stalls, world.records, world.storedChunks);
+    printf("final score:       %d, game resets: %d\n", GetScore(), resets);
+    printf("snapshot:          %zu bytes, %.0f us capture, %.0f us restore\n",
+        snapshot.size, captureTime / 1000, restoreTime / 1000);
+    printf("state hash:        %016llx\n", HashGameState());
+
+    UnloadGame();
+    UnloadReplay(&replay);
+    UnloadSnapshot(&snapshot);
+    return 0;
+}
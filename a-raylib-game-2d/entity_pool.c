@@ -0,0 +1,58 @@
+#include "entity_pool.h"
+#include <stddef.h>
+
+// Free sparse entries store -2 - next, so every free entry is negative
+// and the end of the free list (-1) encodes as -1 as well.
+#define ENCODE_FREE(next) (-2 - (next))
+#define DECODE_FREE(value) (-2 - (value))
+
+void InitEntityPool(EntityPool* pool, int* sparse, int* dense, int capacity) {
+    pool->sparse = sparse;
+    pool->dense = dense;
+    pool->capacity = capacity;
+    ClearEntityPool(pool);
+}
+
+void ClearEntityPool(EntityPool* pool) {
+    pool->count = 0;
+    pool->freeHead = pool->capacity > 0 ? 0 : -1;
+
+    for (int h = 0; h < pool->capacity; h++) {
+        int next = (h + 1 < pool->capacity) ? h + 1 : -1;
+        pool->sparse[h] = ENCODE_FREE(next);
+    }
+}
+
+int SpawnEntity(EntityPool* pool) {
+    if (pool->freeHead == -1) return -1;
+
+    int handle = pool->freeHead;
+    int index = pool->count++;
+
+    pool->freeHead = DECODE_FREE(pool->sparse[handle]);
+    pool->sparse[handle] = index;
+    pool->dense[index] = handle;
+    return index;
+}
+
+int DespawnEntity(EntityPool* pool, int index) {
+    int handle = pool->dense[index];
+    int last = --pool->count;
+
+    // Move the last live handle into the hole to keep the dense range packed
+    if (index != last) {
+        int movedHandle = pool->dense[last];
+        pool->dense[index] = movedHandle;
+        pool->sparse[movedHandle] = index;
+    }
+
+    pool->sparse[handle] = ENCODE_FREE(pool->freeHead);
+    pool->freeHead = handle;
+    return last;
+}
+
+int GetEntityIndex(const EntityPool* pool, int handle) {
+    if (handle < 0 || handle >= pool->capacity) return -1;
+    int index = pool->sparse[handle];
+    return index >= 0 ? index : -1;
+}
@@ -0,0 +1,59 @@
+#ifndef ENTITY_POOL_H
+#define ENTITY_POOL_H
+
+// Fixed-capacity pool shared by the structure-of-arrays entity storage in
+// main.c and AI.c. Live entities stay dense in [0, count) so update loops
+// only touch live data, while handles stay stable for as long as the entity
+// lives. Free handles are chained through the unused sparse entries.
+typedef struct {
+    int* sparse;    // handle -> dense index, or encoded next free handle
+    int* dense;     // dense index -> handle
+    int capacity;
+    int count;
+    int freeHead;
+} EntityPool;
+
+void InitEntityPool(EntityPool* pool, int* sparse, int* dense, int capacity);
+void ClearEntityPool(EntityPool* pool);
+
+// Returns the dense index of the new entity, or -1 when the pool is full
+int SpawnEntity(EntityPool* pool);
+
+// Frees the entity at index. The caller must then move its per-entity data
+// from the returned index into index (nothing to do when they are equal).
+int DespawnEntity(EntityPool* pool, int index);
+
+// Returns the dense index for a handle, or -1 if it is not alive
+int GetEntityIndex(const EntityPool* pool, int handle);
+
+static inline int GetEntityHandle(const EntityPool* pool, int index) {
+    return pool->dense[index];
+}
+
+// Helpers for the float arrays of a pool, the compiler can vectorize these
+static inline void IntegratePositions(float* restrict posX, float* restrict posY,
+                                      const float* restrict velX, const float* restrict velY,
+                                      int count) {
+    for (int i = 0; i < count; i++) {
+        posX[i] += velX[i];
+        posY[i] += velY[i];
+    }
+}
+
+static inline void DecrementLifetimes(float* restrict lifetime, float deltaTime, int count) {
+    for (int i = 0; i < count; i++) {
+        lifetime[i] -= deltaTime;
+    }
+}
+
+// Snapshot positions before a tick so drawing can interpolate between ticks
+static inline void CopyPositions(float* restrict prevX, float* restrict prevY,
+                                 const float* restrict posX, const float* restrict posY,
+                                 int count) {
+    for (int i = 0; i < count; i++) {
+        prevX[i] = posX[i];
+        prevY[i] = posY[i];
+    }
+}
+
+#endif // ENTITY_POOL_H
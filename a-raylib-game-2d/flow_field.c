@@ -0,0 +1,415 @@
+#include "flow_field.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define FLOW_UNREACHED 0xFFFF
+#define FLOW_DIR_GOAL 8
+#define FLOW_DIR_NONE 9
+
+// Straight steps cost 2 and diagonal ones 3, close to 1 : sqrt(2)
+#define FLOW_STRAIGHT_COST 2
+#define FLOW_DIAGONAL_COST 3
+#define FLOW_BUCKETS (FLOW_DIAGONAL_COST + 1)
+
+// Past this many changed or lost cells repairing costs more than building
+#define FLOW_REPAIR_LIMIT (FLOW_FIELD_CELLS / 16)
+
+// Straight neighbours first, diagonal dir d cuts past straight dirs d-4 and (d-3)%4
+static const int neighbourOffset[8] = {
+    1, FLOW_FIELD_STRIDE, -1, -FLOW_FIELD_STRIDE,
+    FLOW_FIELD_STRIDE + 1, FLOW_FIELD_STRIDE - 1, -FLOW_FIELD_STRIDE - 1, -FLOW_FIELD_STRIDE + 1
+};
+static const Vector2 neighbourDirections[8] = {
+    { 1.0f, 0.0f }, { 0.0f, 1.0f }, { -1.0f, 0.0f }, { 0.0f, -1.0f },
+    { 0.70710678f, 0.70710678f }, { -0.70710678f, 0.70710678f },
+    { -0.70710678f, -0.70710678f }, { 0.70710678f, -0.70710678f }
+};
+
+// Bucket queue for the integration pass. Costs are small integers, so the
+// open cells only ever span FLOW_BUCKETS distances and each bucket holds
+// a cell at most once.
+typedef struct {
+    int cells[FLOW_FIELD_CELLS];
+    int count;
+} FlowBucket;
+
+static FlowBucket buckets[FLOW_BUCKETS];
+
+// Cells waiting to join a search, by distance. Their distances can be far
+// apart, so they are sorted and fed into the buckets as the search passes.
+typedef struct {
+    int cell;
+    int distance;
+} FlowSeed;
+
+// Scratch for UpdateFlowField, only used within one refresh so none of it
+// is part of the field
+static unsigned char previousBlocked[FLOW_FIELD_CELLS];
+static unsigned char cellFlags[FLOW_FIELD_CELLS];
+static int changedCells[FLOW_FIELD_CELLS];  // Every cell with FLOW_FLAG_CHANGED
+static int changedCount = 0;
+static int lostCells[FLOW_FIELD_CELLS];
+static FlowSeed seeds[FLOW_FIELD_CELLS];
+
+#define FLOW_FLAG_QUEUED 1    // Already waiting to be checked
+#define FLOW_FLAG_LOST 2      // Lost its way to the goal, searched again
+#define FLOW_FLAG_CHANGED 4   // Distance or steps changed, points again
+#define FLOW_FLAG_POINTED 8   // Pointed again already
+
+static int WorldCell(float value) {
+    return (int)floorf(value / FLOW_FIELD_CELL_SIZE);
+}
+
+static int CellIndex(int x, int y) {
+    return (y + 1) * FLOW_FIELD_STRIDE + x + 1;
+}
+
+// Which of the 8 steps out of cell are allowed. Diagonal steps may not cut
+// the corner of a blocked cell.
+static unsigned int GetStepMask(const FlowField* field, int cell) {
+    unsigned int mask = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        if (!field->blocked[cell + neighbourOffset[dir]]) mask |= 1u << dir;
+    }
+    for (int dir = 4; dir < 8; dir++) {
+        unsigned int sides = (1u << (dir - 4)) | (1u << ((dir - 3) % 4));
+        if ((mask & sides) == sides && !field->blocked[cell + neighbourOffset[dir]]) {
+            mask |= 1u << dir;
+        }
+    }
+    return mask;
+}
+
+void ResetFlowField(FlowField* field, Vector2 goal) {
+    field->goalCellX = WorldCell(goal.x);
+    field->goalCellY = WorldCell(goal.y);
+    field->originX = (field->goalCellX - FLOW_FIELD_SIZE / 2) * FLOW_FIELD_CELL_SIZE;
+    field->originY = (field->goalCellY - FLOW_FIELD_SIZE / 2) * FLOW_FIELD_CELL_SIZE;
+    field->valid = false;
+
+    for (int y = 0; y < FLOW_FIELD_STRIDE; y++) {
+        for (int x = 0; x < FLOW_FIELD_STRIDE; x++) {
+            bool border = x == 0 || y == 0 || x == FLOW_FIELD_STRIDE - 1 || y == FLOW_FIELD_STRIDE - 1;
+            field->blocked[y * FLOW_FIELD_STRIDE + x] = border;
+        }
+    }
+}
+
+void AddFlowFieldObstacle(FlowField* field, Vector2 center, float radius) {
+    float localX = center.x - field->originX;
+    float localY = center.y - field->originY;
+    int minX = (int)floorf((localX - radius) / FLOW_FIELD_CELL_SIZE);
+    int maxX = (int)floorf((localX + radius) / FLOW_FIELD_CELL_SIZE);
+    int minY = (int)floorf((localY - radius) / FLOW_FIELD_CELL_SIZE);
+    int maxY = (int)floorf((localY + radius) / FLOW_FIELD_CELL_SIZE);
+
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX >= FLOW_FIELD_SIZE) maxX = FLOW_FIELD_SIZE - 1;
+    if (maxY >= FLOW_FIELD_SIZE) maxY = FLOW_FIELD_SIZE - 1;
+
+    for (int y = minY; y <= maxY; y++) {
+        float dy = (y + 0.5f) * FLOW_FIELD_CELL_SIZE - localY;
+        for (int x = minX; x <= maxX; x++) {
+            float dx = (x + 0.5f) * FLOW_FIELD_CELL_SIZE - localX;
+            if (dx*dx + dy*dy <= radius*radius) {
+                field->blocked[CellIndex(x, y)] = 1;
+            }
+        }
+    }
+}
+
+static int CompareSeeds(const void* a, const void* b) {
+    const FlowSeed* sa = a;
+    const FlowSeed* sb = b;
+    if (sa->distance != sb->distance) return sa->distance < sb->distance ? -1 : 1;
+    return sa->cell - sb->cell;
+}
+
+static void ClearFlowScratch(void) {
+    for (int i = 0; i < FLOW_FIELD_CELLS; i++) {
+        cellFlags[i] = 0;
+    }
+    for (int b = 0; b < FLOW_BUCKETS; b++) {
+        buckets[b].count = 0;
+    }
+    changedCount = 0;
+}
+
+static void MarkFlowCellChanged(int cell) {
+    if (cellFlags[cell] & FLOW_FLAG_CHANGED) return;
+    cellFlags[cell] |= FLOW_FLAG_CHANGED;
+    changedCells[changedCount++] = cell;
+}
+
+static void PushFlowBucket(int cell, int distance) {
+    FlowBucket* bucket = &buckets[distance % FLOW_BUCKETS];
+    bucket->cells[bucket->count++] = cell;
+}
+
+// Dial's algorithm: visit cells in order of distance from the goal, starting
+// from seeds sorted by distance. Cells whose distance drops are flagged.
+static void SearchFlowField(FlowField* field, const FlowSeed* queued, int queuedCount) {
+    int nextQueued = 0;
+    int pending = 0;
+    for (int d = 0; pending > 0 || nextQueued < queuedCount; d++) {
+        if (pending == 0 && queued[nextQueued].distance > d) d = queued[nextQueued].distance;
+        for (; nextQueued < queuedCount && queued[nextQueued].distance == d; nextQueued++) {
+            PushFlowBucket(queued[nextQueued].cell, d);
+            pending++;
+        }
+
+        FlowBucket* bucket = &buckets[d % FLOW_BUCKETS];
+        for (int n = 0; n < bucket->count; n++) {
+            int cell = bucket->cells[n];
+            pending--;
+            if (field->distance[cell] != d) continue;  // Reached cheaper later
+
+            unsigned int steps = GetStepMask(field, cell);
+            for (int dir = 0; dir < 8; dir++) {
+                if (!(steps & (1u << dir))) continue;
+
+                int next = cell + neighbourOffset[dir];
+                int cost = d + (dir < 4 ? FLOW_STRAIGHT_COST : FLOW_DIAGONAL_COST);
+                if (cost < field->distance[next]) {
+                    field->distance[next] = cost;
+                    MarkFlowCellChanged(next);
+                    PushFlowBucket(next, cost);
+                    pending++;
+                }
+            }
+        }
+        bucket->count = 0;
+    }
+}
+
+// Points a reached cell at its cheapest neighbour
+static void PointFlowFieldCell(FlowField* field, int cell) {
+    field->direction[cell] = FLOW_DIR_NONE;
+    if (field->distance[cell] == FLOW_UNREACHED) return;
+    if (field->distance[cell] == 0) {
+        field->direction[cell] = FLOW_DIR_GOAL;
+        return;
+    }
+
+    unsigned int steps = GetStepMask(field, cell);
+    int best = field->distance[cell];
+    for (int dir = 0; dir < 8; dir++) {
+        if (!(steps & (1u << dir))) continue;
+        int next = cell + neighbourOffset[dir];
+        if (field->distance[next] < best) {
+            best = field->distance[next];
+            field->direction[cell] = dir;
+        }
+    }
+}
+
+void BuildFlowField(FlowField* field) {
+    for (int i = 0; i < FLOW_FIELD_CELLS; i++) {
+        field->distance[i] = FLOW_UNREACHED;
+        field->direction[i] = FLOW_DIR_NONE;
+    }
+    ClearFlowScratch();
+
+    // The goal always counts as open, even when an obstacle overlaps it
+    int goal = CellIndex(FLOW_FIELD_SIZE / 2, FLOW_FIELD_SIZE / 2);
+    field->blocked[goal] = 0;
+    field->distance[goal] = 0;
+    FlowSeed start = { goal, 0 };
+    SearchFlowField(field, &start, 1);
+
+    for (int y = 0; y < FLOW_FIELD_SIZE; y++) {
+        for (int x = 0; x < FLOW_FIELD_SIZE; x++) {
+            PointFlowFieldCell(field, CellIndex(x, y));
+        }
+    }
+
+    field->valid = true;
+}
+
+void ClearFlowFieldObstacles(FlowField* field) {
+    for (int i = 0; i < FLOW_FIELD_CELLS; i++) {
+        previousBlocked[i] = field->blocked[i];
+    }
+    for (int y = 0; y < FLOW_FIELD_SIZE; y++) {
+        for (int x = 0; x < FLOW_FIELD_SIZE; x++) {
+            field->blocked[CellIndex(x, y)] = 0;
+        }
+    }
+}
+
+static bool IsFlowFieldBorder(int cell) {
+    int x = cell % FLOW_FIELD_STRIDE;
+    int y = cell / FLOW_FIELD_STRIDE;
+    return x == 0 || y == 0 || x == FLOW_FIELD_STRIDE - 1 || y == FLOW_FIELD_STRIDE - 1;
+}
+
+static int StepCost(int dir) {
+    return dir < 4 ? FLOW_STRAIGHT_COST : FLOW_DIAGONAL_COST;
+}
+
+// A cell keeps its distance while one neighbour on a shortest way to the
+// goal still has its own and can still step over. Steps are symmetric
+// between open cells, so the cell's own steps tell.
+static bool HasWayToGoal(const FlowField* field, int cell) {
+    if (field->distance[cell] == 0) return true;
+    if (field->blocked[cell]) return false;
+
+    unsigned int steps = GetStepMask(field, cell);
+    for (int dir = 0; dir < 8; dir++) {
+        if (!(steps & (1u << dir))) continue;
+        int next = cell + neighbourOffset[dir];
+        if (cellFlags[next] & FLOW_FLAG_LOST) continue;
+        if (field->distance[next] + StepCost(dir) == field->distance[cell]) return true;
+    }
+    return false;
+}
+
+// Cheapest way in from neighbours that kept their distance
+static int GetDistanceFromNeighbours(const FlowField* field, int cell) {
+    int best = FLOW_UNREACHED;
+    unsigned int steps = GetStepMask(field, cell);
+    for (int dir = 0; dir < 8; dir++) {
+        if (!(steps & (1u << dir))) continue;
+        int next = cell + neighbourOffset[dir];
+        if (field->distance[next] == FLOW_UNREACHED) continue;
+        int cost = field->distance[next] + StepCost(dir);
+        if (cost < best) best = cost;
+    }
+    return best;
+}
+
+// Flags the reached cells that lost every shortest way to the goal. Only
+// cells around changed obstacles can lose a step, from there the loss
+// spreads outward to cells that relied on a lost one, in order of distance
+// so every cell is checked after all of its ways in.
+static int FindLostCells(FlowField* field, int seedCount) {
+    qsort(seeds, seedCount, sizeof(FlowSeed), CompareSeeds);
+
+    int lostCount = 0;
+    int nextSeed = 0;
+    int pending = 0;
+    for (int d = 0; pending > 0 || nextSeed < seedCount; d++) {
+        if (pending == 0 && seeds[nextSeed].distance > d) d = seeds[nextSeed].distance;
+        for (; nextSeed < seedCount && seeds[nextSeed].distance == d; nextSeed++) {
+            PushFlowBucket(seeds[nextSeed].cell, d);
+            pending++;
+        }
+
+        FlowBucket* bucket = &buckets[d % FLOW_BUCKETS];
+        for (int n = 0; n < bucket->count; n++) {
+            int cell = bucket->cells[n];
+            pending--;
+            if (HasWayToGoal(field, cell)) continue;
+
+            cellFlags[cell] |= FLOW_FLAG_LOST;
+            MarkFlowCellChanged(cell);
+            lostCells[lostCount++] = cell;
+            for (int dir = 0; dir < 8; dir++) {
+                int next = cell + neighbourOffset[dir];
+                if (cellFlags[next] & FLOW_FLAG_QUEUED) continue;
+                if (field->distance[next] != d + StepCost(dir)) continue;
+                cellFlags[next] |= FLOW_FLAG_QUEUED;
+                PushFlowBucket(next, field->distance[next]);
+                pending++;
+            }
+        }
+        bucket->count = 0;
+    }
+    return lostCount;
+}
+
+void UpdateFlowField(FlowField* field) {
+    if (!field->valid) {
+        BuildFlowField(field);
+        return;
+    }
+
+    int goal = CellIndex(FLOW_FIELD_SIZE / 2, FLOW_FIELD_SIZE / 2);
+    field->blocked[goal] = 0;
+    ClearFlowScratch();
+
+    // Changed obstacles alter the steps of the cells around them, those are
+    // checked first and point again at the end
+    int seedCount = 0;
+    for (int y = 0; y < FLOW_FIELD_SIZE; y++) {
+        for (int x = 0; x < FLOW_FIELD_SIZE; x++) {
+            int cell = CellIndex(x, y);
+            if (field->blocked[cell] == previousBlocked[cell]) continue;
+
+            for (int dir = -1; dir < 8; dir++) {
+                int near = dir < 0 ? cell : cell + neighbourOffset[dir];
+                if (IsFlowFieldBorder(near)) continue;
+                MarkFlowCellChanged(near);
+                if ((cellFlags[near] & FLOW_FLAG_QUEUED) || field->distance[near] == FLOW_UNREACHED) continue;
+                cellFlags[near] |= FLOW_FLAG_QUEUED;
+                seeds[seedCount++] = (FlowSeed){ near, field->distance[near] };
+            }
+        }
+    }
+    if (seedCount > FLOW_REPAIR_LIMIT) {
+        BuildFlowField(field);
+        return;
+    }
+    int lostCount = FindLostCells(field, seedCount);
+    if (lostCount > FLOW_REPAIR_LIMIT) {
+        BuildFlowField(field);
+        return;
+    }
+
+    // Lost cells start over from their neighbours, newly opened cells join
+    // in, and cells around the changes pass on any step that opened up
+    for (int n = 0; n < lostCount; n++) {
+        field->distance[lostCells[n]] = FLOW_UNREACHED;
+    }
+    seedCount = 0;
+    for (int n = 0; n < changedCount; n++) {
+        int cell = changedCells[n];
+        if (field->blocked[cell]) continue;
+        if (field->distance[cell] == FLOW_UNREACHED) field->distance[cell] = GetDistanceFromNeighbours(field, cell);
+        if (field->distance[cell] != FLOW_UNREACHED) seeds[seedCount++] = (FlowSeed){ cell, field->distance[cell] };
+    }
+    qsort(seeds, seedCount, sizeof(FlowSeed), CompareSeeds);
+    SearchFlowField(field, seeds, seedCount);
+
+    // Directions depend on the neighbours' distances, so changed cells and
+    // the cells around them point again. The border never points anywhere,
+    // and changed cells are never on it, so their neighbours stay in the grid.
+    for (int n = 0; n < changedCount; n++) {
+        for (int dir = -1; dir < 8; dir++) {
+            int cell = dir < 0 ? changedCells[n] : changedCells[n] + neighbourOffset[dir];
+            if ((cellFlags[cell] & FLOW_FLAG_POINTED) || IsFlowFieldBorder(cell)) continue;
+            cellFlags[cell] |= FLOW_FLAG_POINTED;
+            PointFlowFieldCell(field, cell);
+        }
+    }
+}
+
+Rectangle GetFlowFieldBounds(const FlowField* field) {
+    return (Rectangle){
+        field->originX,
+        field->originY,
+        FLOW_FIELD_SIZE * FLOW_FIELD_CELL_SIZE,
+        FLOW_FIELD_SIZE * FLOW_FIELD_CELL_SIZE
+    };
+}
+
+bool IsInFlowFieldGoalCell(const FlowField* field, Vector2 position) {
+    return field->valid &&
+           WorldCell(position.x) == field->goalCellX &&
+           WorldCell(position.y) == field->goalCellY;
+}
+
+bool SampleFlowField(const FlowField* field, Vector2 position, Vector2* direction) {
+    if (!field->valid) return false;
+
+    int x = (int)floorf((position.x - field->originX) / FLOW_FIELD_CELL_SIZE);
+    int y = (int)floorf((position.y - field->originY) / FLOW_FIELD_CELL_SIZE);
+    if (x < 0 || y < 0 || x >= FLOW_FIELD_SIZE || y >= FLOW_FIELD_SIZE) return false;
+
+    int dir = field->direction[CellIndex(x, y)];
+    if (dir >= FLOW_DIR_GOAL) return false;
+
+    *direction = neighbourDirections[dir];
+    return true;
+}
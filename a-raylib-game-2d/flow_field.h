@@ -0,0 +1,47 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include "raylib.h"
+#include "game_defs.h"
+
+// Shared navigation grid centered on a goal. Every reachable cell stores
+// the step toward its cheapest neighbour on the way to the goal, so any
+// number of ships can steer around obstacles with one lookup each.
+
+// Cells are stored with a one cell blocked border so neighbour lookups
+// never need bounds checks
+#define FLOW_FIELD_STRIDE (FLOW_FIELD_SIZE + 2)
+#define FLOW_FIELD_CELLS (FLOW_FIELD_STRIDE * FLOW_FIELD_STRIDE)
+
+typedef struct {
+    float originX;      // World position of the corner of cell (0, 0)
+    float originY;
+    int goalCellX;      // World cell the goal was in when the grid was built
+    int goalCellY;
+    unsigned char blocked[FLOW_FIELD_CELLS];
+    unsigned short distance[FLOW_FIELD_CELLS];
+    unsigned char direction[FLOW_FIELD_CELLS];
+    bool valid;
+} FlowField;
+
+// Centers the grid on the cell holding goal and clears all obstacles
+void ResetFlowField(FlowField* field, Vector2 goal);
+// Blocks every cell whose center lies within radius of center
+void AddFlowFieldObstacle(FlowField* field, Vector2 center, float radius);
+// Fills in distances and directions toward the goal
+void BuildFlowField(FlowField* field);
+// Refreshing obstacles around the same goal: clear them, add them again
+// and update. Only cells whose way to the goal may have changed are
+// searched again, the result is the same as a full build.
+void ClearFlowFieldObstacles(FlowField* field);
+void UpdateFlowField(FlowField* field);
+
+// World rectangle covered by the grid
+Rectangle GetFlowFieldBounds(const FlowField* field);
+bool IsInFlowFieldGoalCell(const FlowField* field, Vector2 position);
+
+// Unit direction to follow from position. Returns false outside the grid,
+// in the goal cell or where the goal cannot be reached.
+bool SampleFlowField(const FlowField* field, Vector2 position, Vector2* direction);
+
+#endif // FLOW_FIELD_H
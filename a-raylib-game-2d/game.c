@@ -0,0 +1,1019 @@
+#include "game.h"
+#include "raymath.h"
+#include <stddef.h>
+#include <float.h>
+#include "AI.h"
+#include "rng.h"
+#include "spatial_hash.h"
+#include "neighbour_grid.h"
+#include "projectile_kernels.h"
+#include "job_system.h"
+#include "flow_field.h"
+#include "world_stream.h"
+#include "profiler.h"
+#include "snapshot.h"
+
+#define MAX_QUERY_RESULTS 64
+#define MAX_ASTEROID_CONTACTS (MAX_ASTEROIDS * 2)  // Pairs solved per tick, the rest wait a tick
+#define WINDOW_CHUNKS ((CHUNK_LOAD_RADIUS * 2 + 1) * (CHUNK_LOAD_RADIUS * 2 + 1))
+
+// Two touching asteroids by index, a before b
+typedef struct {
+    int a;
+    int b;
+} AsteroidContact;
+
+static GameConfig config;
+static Player players[MAX_PLAYERS];
+static CoinPool coins = { .texture = TEXTURE_GOLD };
+static AsteroidPool asteroids = { .texture = TEXTURE_ASTEROID };
+static BeamPool beams = { .texture = TEXTURE_BEAM };
+static Station stations[MAX_STATIONS];
+static int score = 0;
+static bool gameOver = false;
+static SpatialHash coinHash;
+static SpatialHash asteroidHash;
+static SpatialHash stationHash;
+static SpatialHash aiShipHash;
+static GameEvents events;
+static GameStats stats;
+static FlowField flowField;
+static long long flowFieldTick = 0;
+static int obstacleIds[MAX_ASTEROIDS];
+static ChunkCoord enteredChunks[MAX_PLAYERS * WINDOW_CHUNKS];
+static bool coinCollected[MAX_COINS];  // Removed once collisions are done
+static Vector2 aiShotPositions[MAX_AI_SHIPS];
+static NeighbourGrid asteroidGrid;  // Contact broad phase, sorted by cell
+static AsteroidContact asteroidContacts[MAX_ASTEROID_CONTACTS];
+static int contactSlots[MAX_QUERY_RESULTS];
+static int flyingIds[MAX_PLAYERS];  // Players flying when the tick began, a crash waits for the next one
+static Vector2 flyingPositions[MAX_PLAYERS];
+static int flyingCount = 0;
+static int aiBeamHits[MAX_PLAYERS];
+
+static const Color playerColors[] = { RED, SKYBLUE, LIME, GOLD, VIOLET, ORANGE, PINK, BEIGE };
+
+static const char* crashMessages[] = {
+    [CRASH_NONE] = NULL,
+    [CRASH_ASTEROID] = "You crashed into an asteroid!",
+    [CRASH_STATION] = "You crashed into a space station, dummy!",
+    [CRASH_AI_SHIP] = "You crashed into an enemy ship!",
+    [CRASH_AI_BEAM] = "Destroyed by enemy fire!"
+};
+
+// Broad phase query that also feeds the collision counters
+static int QueryCollisions(const SpatialHash* hash, Vector2 center, float radius, int* results, int maxResults) {
+    int found = QuerySpatialHash(hash, center, radius, results, maxResults);
+    stats.collisionQueries++;
+    stats.collisionHits += found;
+    return found;
+}
+
+// Beams test the whole step they just took, so fast ones cannot skip past
+// something between two ticks. Hits come back nearest first.
+static int QueryBeamCollisions(const SpatialHash* hash, int beam, float radius, int* results,
+                               float* times, int maxResults) {
+    Vector2 to = { beams.posX[beam], beams.posY[beam] };
+    Vector2 from = { to.x - beams.velX[beam], to.y - beams.velY[beam] };
+    int found = QuerySpatialHashSweep(hash, from, to, radius, results, times, maxResults);
+    stats.collisionQueries++;
+    stats.collisionHits += found;
+    return found;
+}
+
+// Where along its last step a beam first touched something
+static Vector2 GetBeamContact(int beam, float t) {
+    return (Vector2){
+        beams.posX[beam] - beams.velX[beam] * (1.0f - t),
+        beams.posY[beam] - beams.velY[beam] * (1.0f - t)
+    };
+}
+
+static bool IsAsteroidDestroyed(int index) {
+    return asteroids.hits[index] >= ASTEROID_HITS;
+}
+
+static bool AddCoin(const ChunkItem* item, int record, int homeItem) {
+    if (coins.count >= MAX_COINS) return false;
+
+    int i = coins.count++;
+    coins.posX[i] = coins.prevX[i] = item->x;
+    coins.posY[i] = coins.prevY[i] = item->y;
+    coins.velX[i] = item->velX;
+    coins.velY[i] = item->velY;
+    coins.homeChunk[i] = record;
+    coins.homeItem[i] = homeItem;
+    coinCollected[i] = false;
+    return true;
+}
+
+static void RemoveCoin(int index) {
+    int from = --coins.count;
+    if (from == index) return;
+
+    coins.posX[index] = coins.posX[from];
+    coins.posY[index] = coins.posY[from];
+    coins.prevX[index] = coins.prevX[from];
+    coins.prevY[index] = coins.prevY[from];
+    coins.velX[index] = coins.velX[from];
+    coins.velY[index] = coins.velY[from];
+    coins.homeChunk[index] = coins.homeChunk[from];
+    coins.homeItem[index] = coins.homeItem[from];
+    coinCollected[index] = coinCollected[from];
+}
+
+static bool AddAsteroid(const ChunkItem* item, int record, int homeItem) {
+    if (asteroids.count >= MAX_ASTEROIDS) return false;
+
+    int i = asteroids.count++;
+    asteroids.posX[i] = asteroids.prevX[i] = item->x;
+    asteroids.posY[i] = asteroids.prevY[i] = item->y;
+    asteroids.velX[i] = item->velX;
+    asteroids.velY[i] = item->velY;
+    asteroids.size[i] = item->size;
+    asteroids.hits[i] = 0;
+    asteroids.homeChunk[i] = record;
+    asteroids.homeItem[i] = homeItem;
+    return true;
+}
+
+// A piece of a destroyed asteroid, it belongs to no chunk and is gone for
+// good once it leaves the window
+static bool AddAsteroidFragment(Vector2 position, Vector2 velocity, float size) {
+    if (asteroids.count >= MAX_ASTEROIDS) return false;
+
+    int i = asteroids.count++;
+    asteroids.posX[i] = asteroids.prevX[i] = position.x;
+    asteroids.posY[i] = asteroids.prevY[i] = position.y;
+    asteroids.velX[i] = velocity.x;
+    asteroids.velY[i] = velocity.y;
+    asteroids.size[i] = size;
+    asteroids.hits[i] = ASTEROID_HITS - ASTEROID_FRAGMENT_HITS;
+    asteroids.homeChunk[i] = -1;
+    asteroids.homeItem[i] = -1;
+    return true;
+}
+
+static void RemoveAsteroid(int index) {
+    int from = --asteroids.count;
+    if (from == index) return;
+
+    asteroids.posX[index] = asteroids.posX[from];
+    asteroids.posY[index] = asteroids.posY[from];
+    asteroids.prevX[index] = asteroids.prevX[from];
+    asteroids.prevY[index] = asteroids.prevY[from];
+    asteroids.velX[index] = asteroids.velX[from];
+    asteroids.velY[index] = asteroids.velY[from];
+    asteroids.size[index] = asteroids.size[from];
+    asteroids.hits[index] = asteroids.hits[from];
+    asteroids.homeChunk[index] = asteroids.homeChunk[from];
+    asteroids.homeItem[index] = asteroids.homeItem[from];
+}
+
+static bool AddStation(const ChunkItem* item, int record) {
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        if (stations[i].active) continue;
+
+        stations[i].position = (Vector2){ item->x, item->y };
+        stations[i].size = item->size;
+        stations[i].homeChunk = record;
+        stations[i].active = true;
+        return true;
+    }
+    return false;
+}
+
+// Nothing is allowed to appear right on top of a player
+static bool IsClearOfPlayers(const ChunkItem* item) {
+    float clearance = CHUNK_SPAWN_CLEARANCE + item->size/2;
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        if (!players[p].active) continue;
+        float dx = item->x - players[p].position.x;
+        float dy = item->y - players[p].position.y;
+        if (dx*dx + dy*dy <= clearance*clearance) return false;
+    }
+    return true;
+}
+
+// Spawns whatever the chunk still has that is not used up or already out
+// in the world. Items that do not fit stay home until the next visit.
+static void LoadChunk(const ChunkContents* chunk) {
+    int record = GetChunkRecord(chunk->coord);
+    if (record < 0) return;
+
+    for (int k = 0; k < chunk->asteroidCount; k++) {
+        int item = CHUNK_ASTEROID_ITEM(k);
+        if (!IsChunkItemAvailable(record, item) || !IsClearOfPlayers(&chunk->asteroids[k])) continue;
+        if (AddAsteroid(&chunk->asteroids[k], record, item)) MarkChunkItemSpawned(record, item);
+    }
+    for (int k = 0; k < chunk->coinCount; k++) {
+        int item = CHUNK_COIN_ITEM(k);
+        if (!IsChunkItemAvailable(record, item) || !IsClearOfPlayers(&chunk->coins[k])) continue;
+        if (AddCoin(&chunk->coins[k], record, item)) MarkChunkItemSpawned(record, item);
+    }
+    if (chunk->hasStation && IsChunkItemAvailable(record, CHUNK_STATION_ITEM) &&
+        IsClearOfPlayers(&chunk->station) && AddStation(&chunk->station, record)) {
+        MarkChunkItemSpawned(record, CHUNK_STATION_ITEM);
+    }
+}
+
+// Things that drift out of the loaded window go back to their chunk, which
+// spawns them again at home the next time it loads
+static void ReleaseOutsideWindow(void) {
+    for (int i = coins.count - 1; i >= 0; i--) {
+        if (IsInWorldWindow((Vector2){ coins.posX[i], coins.posY[i] })) continue;
+        ReleaseChunkItem(coins.homeChunk[i], coins.homeItem[i]);
+        RemoveCoin(i);
+    }
+    for (int i = asteroids.count - 1; i >= 0; i--) {
+        if (IsInWorldWindow((Vector2){ asteroids.posX[i], asteroids.posY[i] })) continue;
+        if (asteroids.homeChunk[i] >= 0) ReleaseChunkItem(asteroids.homeChunk[i], asteroids.homeItem[i]);
+        RemoveAsteroid(i);
+    }
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        if (!stations[i].active || IsInWorldWindow(stations[i].position)) continue;
+        ReleaseChunkItem(stations[i].homeChunk, CHUNK_STATION_ITEM);
+        stations[i].active = false;
+    }
+}
+
+// Keeps the loaded chunks centered on the players, each has a window
+static void StreamWorld(void) {
+    int entered = 0;
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        if (!players[p].active) continue;
+        entered += UpdateWorldWindow(p, players[p].position, enteredChunks + entered, WINDOW_CHUNKS);
+    }
+    ReleaseOutsideWindow();
+    for (int n = 0; n < entered; n++) {
+        LoadChunk(AcquireChunk(enteredChunks[n]));
+    }
+}
+
+// Breaks a destroyed asteroid into evenly spread pieces flying apart on top
+// of its own drift. Pieces are spaced so they barely touch, the collision
+// pass pushes the rest of the way.
+static void SpawnAsteroidFragments(Vector2 position, Vector2 velocity, float size) {
+    float fragmentSize = size * ASTEROID_FRAGMENT_SCALE;
+    if (fragmentSize < ASTEROID_FRAGMENT_MIN_SIZE) return;
+
+    float angle = GetSimRandomFloat() * 2 * PI;
+    for (int f = 0; f < ASTEROID_FRAGMENTS; f++) {
+        Vector2 direction = { cosf(angle), sinf(angle) };
+        Vector2 piecePosition = {
+            position.x + direction.x * size * 0.3f,
+            position.y + direction.y * size * 0.3f
+        };
+        Vector2 pieceVelocity = {
+            velocity.x + direction.x * ASTEROID_FRAGMENT_SPEED * SIM_TICK_SCALE,
+            velocity.y + direction.y * ASTEROID_FRAGMENT_SPEED * SIM_TICK_SCALE
+        };
+        if (!AddAsteroidFragment(piecePosition, pieceVelocity, fragmentSize)) return;
+        stats.asteroidFragments++;
+        angle += 2 * PI / ASTEROID_FRAGMENTS;
+    }
+}
+
+// Takes collected coins and destroyed asteroids out for good, returns how
+// many. Destroyed asteroids leave their fragments behind at the end of the
+// pool, past where this walk has been.
+static int RemoveUsedUp(void) {
+    int removed = 0;
+    for (int i = coins.count - 1; i >= 0; i--) {
+        if (!coinCollected[i]) continue;
+        ConsumeChunkItem(coins.homeChunk[i], coins.homeItem[i]);
+        RemoveCoin(i);
+        removed++;
+    }
+    for (int i = asteroids.count - 1; i >= 0; i--) {
+        if (!IsAsteroidDestroyed(i)) continue;
+        if (asteroids.homeChunk[i] >= 0) ConsumeChunkItem(asteroids.homeChunk[i], asteroids.homeItem[i]);
+
+        Vector2 position = { asteroids.posX[i], asteroids.posY[i] };
+        Vector2 velocity = { asteroids.velX[i], asteroids.velY[i] };
+        float size = asteroids.size[i];
+        RemoveAsteroid(i);
+        SpawnAsteroidFragments(position, velocity, size);
+        removed++;
+    }
+    return removed;
+}
+
+static void AddEffect(EffectType type, Vector2 position, Vector2 direction, float size) {
+    if (events.effectCount >= MAX_GAME_EFFECTS) return;
+    events.effects[events.effectCount++] = (GameEffect){ type, position, direction, size };
+}
+
+// Squared distance to the nearest player flying this tick
+static float GetFlyingDistanceSqr(Vector2 position) {
+    float nearest = FLT_MAX;
+    for (int f = 0; f < flyingCount; f++) {
+        float distanceSqr = Vector2DistanceSqr(position, flyingPositions[f]);
+        if (distanceSqr < nearest) nearest = distanceSqr;
+    }
+    return nearest;
+}
+
+// Keeps the AI shots nearest a player, those are the ones worth hearing
+static void AddAIShots(void) {
+    int firedCount = GetAIShots(aiShotPositions, MAX_AI_SHIPS);
+    events.aiShots += firedCount;
+
+    for (int s = 0; s < firedCount; s++) {
+        Vector2 shot = aiShotPositions[s];
+        if (events.shotCount < MAX_GAME_SHOTS) {
+            events.shots[events.shotCount++] = shot;
+            continue;
+        }
+
+        int farthest = 0;
+        for (int k = 1; k < MAX_GAME_SHOTS; k++) {
+            if (GetFlyingDistanceSqr(events.shots[k]) >
+                GetFlyingDistanceSqr(events.shots[farthest])) farthest = k;
+        }
+        if (GetFlyingDistanceSqr(shot) < GetFlyingDistanceSqr(events.shots[farthest])) {
+            events.shots[farthest] = shot;
+        }
+    }
+}
+
+static void RemoveBeam(int index) {
+    int from = DespawnEntity(&beams.pool, index);
+    if (from == index) return;
+
+    beams.posX[index] = beams.posX[from];
+    beams.posY[index] = beams.posY[from];
+    beams.prevX[index] = beams.prevX[from];
+    beams.prevY[index] = beams.prevY[from];
+    beams.velX[index] = beams.velX[from];
+    beams.velY[index] = beams.velY[from];
+    beams.lifetime[index] = beams.lifetime[from];
+}
+
+// Remembers where everything was before the next tick, for render interpolation
+void SavePreviousState(void) {
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        players[p].prevPosition = players[p].position;
+    }
+    CopyPositions(coins.prevX, coins.prevY, coins.posX, coins.posY, coins.count);
+    CopyPositions(asteroids.prevX, asteroids.prevY, asteroids.posX, asteroids.posY, asteroids.count);
+    CopyPositions(beams.prevX, beams.prevY, beams.posX, beams.posY, beams.pool.count);
+}
+
+static void UnloadSpatialHashes(void) {
+    UnloadSpatialHash(&coinHash);
+    UnloadSpatialHash(&asteroidHash);
+    UnloadSpatialHash(&stationHash);
+    UnloadSpatialHash(&aiShipHash);
+    UnloadNeighbourGrid(&asteroidGrid);
+}
+
+// InitGame runs again when a snapshot of another game is restored, so
+// anything left from the last one is freed first
+static void InitSpatialHashes(void) {
+    UnloadSpatialHashes();
+    InitSpatialHash(&coinHash, SPATIAL_HASH_CELL_SIZE, MAX_COINS);
+    InitSpatialHash(&asteroidHash, SPATIAL_HASH_CELL_SIZE, MAX_ASTEROIDS);
+    InitSpatialHash(&stationHash, SPATIAL_HASH_CELL_SIZE, MAX_STATIONS);
+    InitSpatialHash(&aiShipHash, SPATIAL_HASH_CELL_SIZE, MAX_AI_SHIPS);
+    // No two asteroids reach further apart than the largest size, so
+    // every contact is found in the cells around the asteroid's own
+    InitNeighbourGrid(&asteroidGrid, ASTEROID_MAX_SIZE, MAX_ASTEROIDS);
+}
+
+static void BuildAsteroidSpatialHash(void) {
+    ClearSpatialHash(&asteroidHash);
+    for (int i = 0; i < asteroids.count; i++) {
+        InsertSpatialHash(&asteroidHash, i, (Vector2){ asteroids.posX[i], asteroids.posY[i] }, asteroids.size[i]/2);
+    }
+}
+
+// Rebuilt every tick after coins and asteroids have moved
+static void BuildWorldSpatialHashes(void) {
+    ClearSpatialHash(&coinHash);
+    ClearSpatialHash(&stationHash);
+
+    for (int i = 0; i < coins.count; i++) {
+        InsertSpatialHash(&coinHash, i, (Vector2){ coins.posX[i], coins.posY[i] }, COIN_SIZE/2);
+    }
+    BuildAsteroidSpatialHash();
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        if (stations[i].active) InsertSpatialHash(&stationHash, i, stations[i].position, stations[i].size/2);
+    }
+}
+
+// Finds every pair of touching asteroids once. The grid is walked slot by
+// slot, so pairs come out cell by cell in an order fixed by the positions.
+static int FindAsteroidContacts(void) {
+    BuildNeighbourGrid(&asteroidGrid, asteroids.posX, asteroids.posY, asteroids.count);
+
+    const NeighbourGrid* grid = &asteroidGrid;
+    int count = 0;
+    for (int s = 0; s < grid->count; s++) {
+        int i = grid->ids[s];
+        float radius = asteroids.size[i]/2;
+        Vector2 center = { grid->x[s], grid->y[s] };
+        int found = QueryNeighbourGrid(grid, center, radius + ASTEROID_MAX_SIZE/2, contactSlots, MAX_QUERY_RESULTS);
+
+        for (int n = 0; n < found; n++) {
+            int j = grid->ids[contactSlots[n]];
+            if (j <= i) continue;  // Found from the other side as well
+
+            float dx = grid->x[contactSlots[n]] - center.x;
+            float dy = grid->y[contactSlots[n]] - center.y;
+            float reach = radius + asteroids.size[j]/2;
+            if (dx*dx + dy*dy >= reach*reach) continue;
+
+            if (count >= MAX_ASTEROID_CONTACTS) return count;
+            asteroidContacts[count++] = (AsteroidContact){ i, j };
+        }
+    }
+    return count;
+}
+
+// Bounces touching asteroids off each other, heavier ones by their area
+// barely moving for lighter ones, and pushes them apart so they do not sink
+// in. The pairs are found first and then solved one after the other in
+// that order, so the outcome does not depend on threads. Returns how many
+// pairs were touching.
+static int ResolveAsteroidContacts(void) {
+    int pairCount = FindAsteroidContacts();
+    int contacts = 0;
+
+    for (int p = 0; p < pairCount; p++) {
+        int i = asteroidContacts[p].a;
+        int j = asteroidContacts[p].b;
+
+        // Earlier pairs may have moved either one already
+        float dx = asteroids.posX[i] - asteroids.posX[j];
+        float dy = asteroids.posY[i] - asteroids.posY[j];
+        float reach = asteroids.size[i]/2 + asteroids.size[j]/2;
+        float distanceSq = dx*dx + dy*dy;
+        if (distanceSq >= reach*reach) continue;
+
+        // Normal from j to i, any direction works for exact overlaps
+        float distance = sqrtf(distanceSq);
+        float nx = distance > 0.0f ? dx / distance : 1.0f;
+        float ny = distance > 0.0f ? dy / distance : 0.0f;
+        float massI = asteroids.size[i] * asteroids.size[i];
+        float massJ = asteroids.size[j] * asteroids.size[j];
+        float shareI = massJ / (massI + massJ);
+        float shareJ = massI / (massI + massJ);
+
+        float depth = reach - distance;
+        asteroids.posX[i] += nx * depth * shareI;
+        asteroids.posY[i] += ny * depth * shareI;
+        asteroids.posX[j] -= nx * depth * shareJ;
+        asteroids.posY[j] -= ny * depth * shareJ;
+
+        // Only pairs still closing get an impulse, separating ones are left alone
+        float closing = (asteroids.velX[i] - asteroids.velX[j]) * nx +
+                        (asteroids.velY[i] - asteroids.velY[j]) * ny;
+        if (closing < 0.0f) {
+            float impulse = -(1.0f + ASTEROID_RESTITUTION) * closing;
+            asteroids.velX[i] += nx * impulse * shareI;
+            asteroids.velY[i] += ny * impulse * shareI;
+            asteroids.velX[j] -= nx * impulse * shareJ;
+            asteroids.velY[j] -= ny * impulse * shareJ;
+        }
+        contacts++;
+    }
+
+    stats.collisionQueries++;
+    stats.collisionHits += pairCount;
+    stats.asteroidContacts += contacts;
+    return contacts;
+}
+
+// Rebuilt every tick after the AI has moved
+static void BuildAISpatialHashes(void) {
+    ClearSpatialHash(&aiShipHash);
+
+    for (int i = 0; i < GetAIShipCount(); i++) {
+        int handle = GetAIShipHandle(i);
+        InsertSpatialHash(&aiShipHash, handle, GetAIShipPosition(handle), AI_SHIP_SIZE/2);
+    }
+}
+
+// Rebuilds the AI flow field when the player changes cell. Every few ticks
+// in between the obstacles are gathered again so it keeps up with drifting
+// asteroids, and only the cells whose way to the player changed are updated.
+// A new goal changes every distance, so that still needs a full build. The
+// field leads to the first player flying, ships after the others fly straight.
+static void UpdateNavigation(void) {
+    if (flyingCount == 0) return;
+    Vector2 goal = flyingPositions[0];
+    bool sameGoal = IsInFlowFieldGoalCell(&flowField, goal);
+    if (sameGoal && stats.ticks - flowFieldTick < FLOW_FIELD_REFRESH_TICKS) {
+        return;
+    }
+
+    if (sameGoal) {
+        ClearFlowFieldObstacles(&flowField);
+    } else {
+        ResetFlowField(&flowField, goal);
+    }
+
+    Rectangle bounds = GetFlowFieldBounds(&flowField);
+    int count = QuerySpatialHashRect(&asteroidHash, bounds, obstacleIds, MAX_ASTEROIDS);
+    for (int n = 0; n < count; n++) {
+        int i = obstacleIds[n];
+        AddFlowFieldObstacle(&flowField, (Vector2){ asteroids.posX[i], asteroids.posY[i] },
+                             asteroids.size[i]/2 + FLOW_FIELD_CLEARANCE);
+    }
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        if (stations[i].active) {
+            AddFlowFieldObstacle(&flowField, stations[i].position, stations[i].size/2 + FLOW_FIELD_CLEARANCE);
+        }
+    }
+
+    if (sameGoal) {
+        UpdateFlowField(&flowField);
+        stats.flowFieldUpdates++;
+    } else {
+        BuildFlowField(&flowField);
+        stats.flowFieldBuilds++;
+    }
+    flowFieldTick = stats.ticks;
+}
+
+// Place of slot id in a row of players, 0 in the middle and the others
+// taking turns right and left of it
+static Vector2 GetSpawnOffset(int id) {
+    int step = (id + 1) / 2;
+    return (Vector2){ (id % 2 == 1 ? step : -step) * PLAYER_SPAWN_SPACING, 0 };
+}
+
+static void SpawnPlayer(Player* player, Vector2 position) {
+    player->position = position;
+    player->prevPosition = position;
+    player->rotation = PLAYER_BASE_ROTATION;
+    player->health = PLAYER_MAX_HEALTH;
+    player->alive = true;
+    player->input = 0;
+    player->shootTimer = 0.0f;
+    player->crashReason = CRASH_NONE;
+}
+
+void ResetGame(void) {
+    Vector2 start = { WINDOW_WIDTH/2, WINDOW_HEIGHT/2 };
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        if (players[p].active) SpawnPlayer(&players[p], Vector2Add(start, GetSpawnOffset(p)));
+    }
+    score = 0;
+    gameOver = false;
+
+    // Reset beams
+    ClearEntityPool(&beams.pool);
+
+    // Empty the world and load the chunks around the start position again,
+    // everything used up in the last game comes back
+    coins.count = 0;
+    asteroids.count = 0;
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        stations[i].active = false;
+    }
+    ResetWorldStream();
+    StreamWorld();
+
+    // Culling reads the broad phase before the first tick runs
+    BuildWorldSpatialHashes();
+    BuildAISpatialHashes();
+    flowField.valid = false;
+}
+
+bool AddPlayer(int id) {
+    if (id < 0 || id >= MAX_PLAYERS || players[id].active) return false;
+
+    // A newcomer starts in the action, next to the first player still flying
+    int lead = -1;
+    for (int p = 0; p < MAX_PLAYERS && lead < 0; p++) {
+        if (players[p].active && players[p].alive) lead = p;
+    }
+    Vector2 position = { WINDOW_WIDTH/2, WINDOW_HEIGHT/2 };
+    if (lead >= 0) {
+        position = Vector2Subtract(players[lead].position, GetSpawnOffset(lead));
+    }
+
+    Player* player = &players[id];
+    *player = (Player){
+        .size = PLAYER_SIZE,
+        .color = playerColors[id % (int)(sizeof(playerColors) / sizeof(playerColors[0]))],
+        .active = true
+    };
+    SpawnPlayer(player, Vector2Add(position, GetSpawnOffset(id)));
+    // A game that is over is joined at the restart
+    if (gameOver) player->alive = false;
+    return true;
+}
+
+void RemovePlayer(int id) {
+    if (id < 0 || id >= MAX_PLAYERS || !players[id].active) return;
+    players[id].active = false;
+    players[id].alive = false;
+    CloseWorldWindow(id);
+}
+
+static void MovePlayer(Player* player, float deltaTime) {
+    unsigned int input = player->input;
+    player->shootTimer -= deltaTime;
+
+    // Update player movement and rotation
+    if (((input & INPUT_RIGHT) || (input & INPUT_LEFT)) && 
+        ((input & INPUT_UP) || (input & INPUT_DOWN))) {
+        float moveSpeed = PLAYER_SPEED_DIAGONAL * SIM_TICK_SCALE;
+
+        if ((input & INPUT_RIGHT)) player->position.x += moveSpeed;
+        if ((input & INPUT_LEFT)) player->position.x -= moveSpeed;
+        if ((input & INPUT_UP)) player->position.y -= moveSpeed;
+        if ((input & INPUT_DOWN)) player->position.y += moveSpeed;
+    } else {
+        float moveSpeed = PLAYER_SPEED * SIM_TICK_SCALE;
+
+        if ((input & INPUT_RIGHT)) player->position.x += moveSpeed;
+        if ((input & INPUT_LEFT)) player->position.x -= moveSpeed;
+        if ((input & INPUT_UP)) player->position.y -= moveSpeed;
+        if ((input & INPUT_DOWN)) player->position.y += moveSpeed;
+    }
+
+    // Update rotation based on movement
+    if ((input & INPUT_RIGHT) && !(input & INPUT_LEFT)) {
+        if ((input & INPUT_UP)) player->rotation = PLAYER_BASE_ROTATION + 45;
+        else if ((input & INPUT_DOWN)) player->rotation = PLAYER_BASE_ROTATION + 135;
+        else player->rotation = PLAYER_BASE_ROTATION + 90;
+    }
+    else if ((input & INPUT_LEFT) && !(input & INPUT_RIGHT)) {
+        if ((input & INPUT_UP)) player->rotation = PLAYER_BASE_ROTATION - 45;
+        else if ((input & INPUT_DOWN)) player->rotation = PLAYER_BASE_ROTATION - 135;
+        else player->rotation = PLAYER_BASE_ROTATION - 90;
+    }
+    else if ((input & INPUT_UP)) player->rotation = PLAYER_BASE_ROTATION;
+    else if ((input & INPUT_DOWN)) player->rotation = PLAYER_BASE_ROTATION + 180;
+}
+
+static void ShootPlayerBeam(int id) {
+    Player* player = &players[id];
+    if (!(player->input & INPUT_FIRE) || player->shootTimer > 0) return;
+
+    int i = SpawnEntity(&beams.pool);
+    if (i < 0) return;
+
+    // Calculate beam starting position at front of ship
+    float offsetDistance = player->size * 0.75f;
+    beams.posX[i] = player->position.x + cosf((player->rotation - 90) * DEG2RAD) * offsetDistance;
+    beams.posY[i] = player->position.y + sinf((player->rotation - 90) * DEG2RAD) * offsetDistance;
+    beams.prevX[i] = beams.posX[i];
+    beams.prevY[i] = beams.posY[i];
+
+    // Calculate beam velocity based on ship rotation
+    float angle = (player->rotation - 90) * DEG2RAD;
+    beams.velX[i] = cosf(angle) * BEAM_SPEED * SIM_TICK_SCALE;
+    beams.velY[i] = sinf(angle) * BEAM_SPEED * SIM_TICK_SCALE;
+
+    beams.lifetime[i] = BEAM_LIFETIME;
+    events.playerShots++;
+    events.playerShooters |= 1u << id;
+    player->shootTimer = SHOOT_COOLDOWN;
+}
+
+// Health runs out into a crash
+static void DamagePlayer(Player* player, float damage, CrashReason reason) {
+    player->health -= damage;
+    events.playerHits++;
+    if (player->health <= 0) {
+        player->alive = false;
+        player->crashReason = reason;
+    }
+}
+
+// Advances the simulation by one fixed tick
+void UpdateGamePlayers(const unsigned int* inputs, float deltaTime) {
+    stats.ticks++;
+
+    flyingCount = 0;
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        players[p].input = players[p].active ? inputs[p] : 0;
+        if (players[p].active && players[p].alive) flyingIds[flyingCount++] = p;
+    }
+    for (int f = 0; f < flyingCount; f++) {
+        MovePlayer(&players[flyingIds[f]], deltaTime);
+        flyingPositions[f] = players[flyingIds[f]].position;
+    }
+
+    // Shooting mechanics
+    BeginProfileZone(PROFILE_BEAMS);
+    for (int f = 0; f < flyingCount; f++) {
+        ShootPlayerBeam(flyingIds[f]);
+    }
+
+    // Update beams
+    unsigned int beamAlive[ALIVE_MASK_WORDS(MAX_BEAMS)];
+    int beamsAlive = UpdateProjectiles(beams.posX, beams.posY, beams.velX, beams.velY,
+                                       beams.lifetime, deltaTime, beams.pool.count, beamAlive);
+    for (int i = beams.pool.count - 1; i >= 0 && beamsAlive < beams.pool.count; i--) {
+        if (!IsProjectileAlive(beamAlive, i)) RemoveBeam(i);
+    }
+    EndProfileZone(PROFILE_BEAMS);
+
+    // Update coins and asteroids
+    BeginProfileZone(PROFILE_WORLD);
+    IntegratePositions(coins.posX, coins.posY, coins.velX, coins.velY, coins.count);
+    IntegratePositions(asteroids.posX, asteroids.posY, asteroids.velX, asteroids.velY, asteroids.count);
+    StreamWorld();
+
+    BuildWorldSpatialHashes();
+    if (ResolveAsteroidContacts() > 0) BuildAsteroidSpatialHash();
+    EndProfileZone(PROFILE_WORLD);
+
+    int found[MAX_QUERY_RESULTS];
+    float foundTimes[MAX_QUERY_RESULTS];
+
+    // Check beam collision with asteroids, backwards so removals stay valid.
+    // Destroyed asteroids stay in the pool until the checks are done.
+    BeginProfileZone(PROFILE_COLLISIONS);
+    for (int i = beams.pool.count - 1; i >= 0; i--) {
+        int hitCount = QueryBeamCollisions(&asteroidHash, i, 4, found, foundTimes, 4);
+        for (int h = 0; h < hitCount; h++) {
+            int j = found[h];
+            if (IsAsteroidDestroyed(j)) continue;
+
+            Vector2 beamPos = GetBeamContact(i, foundTimes[h]);
+            Vector2 beamDir = { beams.velX[i], beams.velY[i] };
+            RemoveBeam(i);
+            asteroids.hits[j]++;
+            events.asteroidHits++;
+
+            if (IsAsteroidDestroyed(j)) {
+                events.asteroidsDestroyed++;
+                score += 5;  // Bonus points for destroying asteroid
+                AddEffect(EFFECT_EXPLOSION, (Vector2){ asteroids.posX[j], asteroids.posY[j] },
+                          (Vector2){ 0, 0 }, asteroids.size[j]);
+            } else {
+                AddEffect(EFFECT_IMPACT, beamPos, beamDir, asteroids.size[j]);
+            }
+            break;
+        }
+    }
+
+    int hitCount;
+    for (int f = 0; f < flyingCount; f++) {
+        Player* player = &players[flyingIds[f]];
+
+        // Check player collision with coins
+        hitCount = QueryCollisions(&coinHash, player->position, player->size/2, found, MAX_QUERY_RESULTS);
+        for (int h = 0; h < hitCount; h++) {
+            if (coinCollected[found[h]]) continue;
+            coinCollected[found[h]] = true;
+            score++;
+            events.coinsCollected++;
+        }
+
+        // Check player collision with asteroids
+        hitCount = QueryCollisions(&asteroidHash, player->position, player->size/2, found, MAX_QUERY_RESULTS);
+        for (int h = 0; h < hitCount; h++) {
+            if (IsAsteroidDestroyed(found[h])) continue;
+            DamagePlayer(player, ASTEROID_DAMAGE, CRASH_ASTEROID);
+        }
+
+        // Add station collision check
+        if (QueryCollisions(&stationHash, player->position, player->size/2, found, 1) > 0) {
+            player->alive = false;
+            player->crashReason = CRASH_STATION;
+        }
+    }
+
+    // Collected and destroyed things leave before anything else looks
+    if (RemoveUsedUp() > 0) BuildWorldSpatialHashes();
+    EndProfileZone(PROFILE_COLLISIONS);
+
+    // Update AI
+    BeginProfileZone(PROFILE_AI);
+    UpdateNavigation();
+    UpdateAI(flyingPositions, flyingCount, &flowField, deltaTime);
+    AddAIShots();
+    AILodStats lodStats = GetAILodStats();
+    for (int t = 0; t < AI_LOD_TIER_COUNT; t++) {
+        stats.aiShipUpdates[t] += lodStats.updated[t];
+    }
+    EndProfileZone(PROFILE_AI);
+
+    // Add AI beam update, it reports the beams that hit each player
+    BeginProfileZone(PROFILE_AI_BEAMS);
+    stats.collisionHits += UpdateAIBeams(flyingPositions, flyingCount, aiBeamHits, deltaTime);
+    EndProfileZone(PROFILE_AI_BEAMS);
+
+    BeginProfileZone(PROFILE_COLLISIONS);
+    BuildAISpatialHashes();
+
+    for (int f = 0; f < flyingCount; f++) {
+        Player* player = &players[flyingIds[f]];
+
+        // Add player-AI collision check
+        hitCount = QueryCollisions(&aiShipHash, player->position, player->size/2, found, MAX_QUERY_RESULTS);
+        for (int h = 0; h < hitCount; h++) {
+            DamagePlayer(player, AI_COLLISION_DAMAGE, CRASH_AI_SHIP);
+        }
+
+        // Add AI beam collision with player
+        for (int h = 0; h < aiBeamHits[f]; h++) {
+            DamagePlayer(player, AI_BEAM_DAMAGE, CRASH_AI_BEAM);
+        }
+    }
+
+    // Add player beam collision with AI ships. The hash is not rebuilt when
+    // a ship is destroyed, so later beams skip the handles of dead ones.
+    for (int i = beams.pool.count - 1; i >= 0; i--) {
+        hitCount = QueryBeamCollisions(&aiShipHash, i, BEAM_SIZE/2, found, foundTimes, 4);
+        for (int h = 0; h < hitCount; h++) {
+            int handle = found[h];
+            if (!IsAIShipActive(handle)) continue;
+
+            Vector2 shipPos = GetAIShipPosition(handle);
+            if (DamageAIShip(handle, PLAYER_BEAM_DAMAGE)) {
+                AddEffect(EFFECT_EXPLOSION, shipPos, (Vector2){ 0, 0 }, AI_SHIP_SIZE);
+            } else {
+                AddEffect(EFFECT_IMPACT, GetBeamContact(i, foundTimes[h]),
+                          (Vector2){ beams.velX[i], beams.velY[i] }, AI_SHIP_SIZE);
+            }
+            RemoveBeam(i);
+            events.aiShipHits++;
+            score += 2;  // Bonus points for hitting enemy ships
+            break;
+        }
+    }
+    EndProfileZone(PROFILE_COLLISIONS);
+
+    // The game is over once nobody in it is flying
+    bool anyActive = false;
+    bool anyAlive = false;
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        anyActive = anyActive || players[p].active;
+        anyAlive = anyAlive || players[p].alive;
+    }
+    if (anyActive && !anyAlive) gameOver = true;
+}
+
+void UpdateGame(unsigned int input, float deltaTime) {
+    unsigned int inputs[MAX_PLAYERS] = { input };
+    UpdateGamePlayers(inputs, deltaTime);
+}
+
+GameConfig GetDefaultGameConfig(void) {
+    return (GameConfig){
+        .seed = 1,
+        .coinsPerChunk = DEFAULT_COINS_PER_CHUNK,
+        .asteroidsPerChunk = DEFAULT_ASTEROIDS_PER_CHUNK,
+        .aiShipCount = MAX_AI_SHIPS,
+        .workerCount = 0
+    };
+}
+
+static int ClampCount(int count, int max) {
+    if (count < 0) return 0;
+    return count > max ? max : count;
+}
+
+void InitGame(GameConfig gameConfig) {
+    config = gameConfig;
+    config.coinsPerChunk = ClampCount(config.coinsPerChunk, CHUNK_MAX_COINS);
+    config.asteroidsPerChunk = ClampCount(config.asteroidsPerChunk, CHUNK_MAX_ASTEROIDS);
+    config.aiShipCount = ClampCount(config.aiShipCount, MAX_AI_SHIPS);
+
+    SeedSimRandom(config.seed);
+    events = (GameEvents){ 0 };
+    stats = (GameStats){ 0 };
+
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        players[p] = (Player){ 0 };
+    }
+    gameOver = false;
+
+    InitJobSystem(config.workerCount);
+    InitAI(config.aiShipCount);
+    InitAIBeams();
+    InitSpatialHashes();
+    InitWorldStream(config.seed, config.asteroidsPerChunk, config.coinsPerChunk);
+    InitEntityPool(&beams.pool, beams.sparse, beams.dense, MAX_BEAMS);
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        stations[i].texture = TEXTURE_STATION;
+    }
+
+    AddPlayer(0);
+    ResetGame();
+}
+
+void UnloadGame(void) {
+    UnloadAI();
+    UnloadSpatialHashes();
+    ShutdownWorldStream();
+    ShutdownJobSystem();
+}
+
+const Player* GetPlayer(int id) {
+    return &players[id];
+}
+
+const CoinPool* GetCoins(void) {
+    return &coins;
+}
+
+const AsteroidPool* GetAsteroids(void) {
+    return &asteroids;
+}
+
+const BeamPool* GetBeams(void) {
+    return &beams;
+}
+
+const FlowField* GetFlowField(void) {
+    return &flowField;
+}
+
+const Station* GetStations(void) {
+    return stations;
+}
+
+int GetScore(void) {
+    return score;
+}
+
+bool IsGameOver(void) {
+    return gameOver;
+}
+
+const char* GetCrashReason(int id) {
+    return players[id].alive ? NULL : crashMessages[players[id].crashReason];
+}
+
+GameEvents ConsumeGameEvents(void) {
+    GameEvents pending = events;
+    events = (GameEvents){ 0 };
+    return pending;
+}
+
+GameStats GetGameStats(void) {
+    return stats;
+}
+
+GameConfig GetGameConfig(void) {
+    return config;
+}
+
+int GetGameStateRegions(StateRegion* regions, int maxRegions) {
+    // The config travels in the snapshot header, the broad phase and the
+    // scratch arrays are rebuilt or refilled every tick
+    StateRegion own[] = {
+        { players, sizeof(players) },
+        { &coins, sizeof(coins) },
+        { &asteroids, sizeof(asteroids) },
+        { &beams, sizeof(beams) },
+        { stations, sizeof(stations) },
+        { &score, sizeof(score) },
+        { &gameOver, sizeof(gameOver) },
+        { &events, sizeof(events) },
+        { &stats, sizeof(stats) },
+        { &flowField, sizeof(flowField) },
+        { &flowFieldTick, sizeof(flowFieldTick) }
+    };
+    int count = sizeof(own) / sizeof(own[0]);
+    if (count > maxRegions) return -1;
+    for (int r = 0; r < count; r++) {
+        regions[r] = own[r];
+    }
+
+    int added = GetAIStateRegions(regions + count, maxRegions - count);
+    if (added < 0) return -1;
+    count += added;
+
+    added = GetWorldStreamStateRegions(regions + count, maxRegions - count);
+    if (added < 0 || count + added >= maxRegions) return -1;
+    count += added;
+
+    regions[count++] = GetSimRandomStateRegion();
+    return count;
+}
+
+void RestoreGameState(void) {
+    beams.pool.sparse = beams.sparse;
+    beams.pool.dense = beams.dense;
+    RestoreAIState();
+
+    BuildWorldSpatialHashes();
+    BuildAISpatialHashes();
+}
+
+int QueryVisibleEntities(CullGroup group, Rectangle view, int* results, int maxResults) {
+    const SpatialHash* hashes[] = {
+        [CULL_COINS] = &coinHash,
+        [CULL_ASTEROIDS] = &asteroidHash,
+        [CULL_STATIONS] = &stationHash,
+        [CULL_AI_SHIPS] = &aiShipHash
+    };
+    Rectangle bounds = {
+        view.x - CULL_MARGIN,
+        view.y - CULL_MARGIN,
+        view.width + CULL_MARGIN * 2,
+        view.height + CULL_MARGIN * 2
+    };
+    return QuerySpatialHashRect(hashes[group], bounds, results, maxResults);
+}
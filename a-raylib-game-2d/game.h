@@ -0,0 +1,214 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "raylib.h"
+#include "game_defs.h"
+#include "entity_pool.h"
+#include "flow_field.h"
+#include "AI.h"
+#include "world_stream.h"
+#include "snapshot.h"
+
+// Game simulation for Space Collector. Nothing in here opens a window or
+// plays audio, so it can run headless for benchmarks and tests. The
+// frontend feeds input once per tick and reads state back for drawing.
+
+// Player input sampled once per tick
+typedef enum {
+    INPUT_LEFT  = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_UP    = 1 << 2,
+    INPUT_DOWN  = 1 << 3,
+    INPUT_FIRE  = 1 << 4
+} InputFlags;
+
+typedef enum {
+    TEXTURE_SHIP,
+    TEXTURE_GOLD,
+    TEXTURE_ASTEROID,
+    TEXTURE_JET,
+    TEXTURE_BEAM,
+    TEXTURE_STATION,
+    TEXTURE_COUNT
+} TextureId;
+
+// Why a player crashed, a number so snapshots can hold it
+typedef enum {
+    CRASH_NONE,
+    CRASH_ASTEROID,
+    CRASH_STATION,
+    CRASH_AI_SHIP,
+    CRASH_AI_BEAM
+} CrashReason;
+
+// Every player has a slot of its own, a local game only uses slot 0
+typedef struct {
+    Vector2 position;
+    Vector2 prevPosition;
+    float size;
+    Color color;
+    float rotation;
+    float health;
+    bool active;              // Someone is in the slot, flying or crashed
+    bool alive;               // Still flying
+    unsigned int input;       // Used on the last tick, clients predict other players with it
+    float shootTimer;
+    CrashReason crashReason;
+} Player;
+
+// Coins, asteroids and beams are stored as structure-of-arrays with the live
+// entities packed in [0, count), textures are looked up by id when drawing.
+// Coins, asteroids and stations remember the chunk record and item number
+// they were generated as, so the world stream knows when they are gone.
+// Asteroid fragments were never generated and have a home chunk of -1.
+typedef struct {
+    float posX[MAX_COINS];
+    float posY[MAX_COINS];
+    float prevX[MAX_COINS];
+    float prevY[MAX_COINS];
+    float velX[MAX_COINS];
+    float velY[MAX_COINS];
+    int homeChunk[MAX_COINS];
+    int homeItem[MAX_COINS];
+    int count;
+    TextureId texture;
+} CoinPool;
+
+typedef struct {
+    float posX[MAX_ASTEROIDS];
+    float posY[MAX_ASTEROIDS];
+    float prevX[MAX_ASTEROIDS];
+    float prevY[MAX_ASTEROIDS];
+    float velX[MAX_ASTEROIDS];
+    float velY[MAX_ASTEROIDS];
+    float size[MAX_ASTEROIDS];
+    int hits[MAX_ASTEROIDS];
+    int homeChunk[MAX_ASTEROIDS];
+    int homeItem[MAX_ASTEROIDS];
+    int count;
+    TextureId texture;
+} AsteroidPool;
+
+typedef struct {
+    float posX[MAX_BEAMS];
+    float posY[MAX_BEAMS];
+    float prevX[MAX_BEAMS];
+    float prevY[MAX_BEAMS];
+    float velX[MAX_BEAMS];
+    float velY[MAX_BEAMS];
+    float lifetime[MAX_BEAMS];
+    int sparse[MAX_BEAMS];
+    int dense[MAX_BEAMS];
+    EntityPool pool;
+    TextureId texture;
+} BeamPool;
+
+typedef struct {
+    Vector2 position;
+    float size;
+    bool active;
+    TextureId texture;
+    int homeChunk;
+} Station;
+
+typedef struct {
+    unsigned int seed;
+    int coinsPerChunk;      // Clamped to CHUNK_MAX_COINS
+    int asteroidsPerChunk;  // Clamped to CHUNK_MAX_ASTEROIDS
+    int aiShipCount;    // Clamped to MAX_AI_SHIPS
+    int workerCount;    // Threads sharing the AI update, 0 for one per core
+} GameConfig;
+
+typedef enum {
+    EFFECT_IMPACT,     // A beam hit something that survived
+    EFFECT_EXPLOSION   // Something was destroyed
+} EffectType;
+
+// Where something happened, for the frontend to draw particles at
+typedef struct {
+    EffectType type;
+    Vector2 position;
+    Vector2 direction;  // Travel direction of what hit, zero for explosions
+    float size;         // Size of what was hit
+} GameEffect;
+
+// Things that happened since the frontend last asked, used for sound and effects
+typedef struct {
+    int playerShots;
+    unsigned int playerShooters;           // Bit per player that fired
+    int asteroidHits;
+    int asteroidsDestroyed;
+    int aiShipHits;
+    int coinsCollected;
+    int playerHits;
+    int effectCount;
+    GameEffect effects[MAX_GAME_EFFECTS];  // Later effects are dropped when full
+    int aiShots;                           // Every AI shot, also those not kept below
+    int shotCount;
+    Vector2 shots[MAX_GAME_SHOTS];         // Where AI ships fired, nearest the player when full
+} GameEvents;
+
+// Running totals since InitGame
+typedef struct {
+    long long ticks;
+    long long collisionQueries;
+    long long collisionHits;
+    long long flowFieldBuilds;    // Built from scratch after the player changed cell
+    long long flowFieldUpdates;   // Obstacles refreshed around the same goal
+    long long asteroidContacts;   // Asteroid pairs that bounced off each other
+    long long asteroidFragments;  // Pieces spawned by destroyed asteroids
+    long long aiShipUpdates[AI_LOD_TIER_COUNT];  // Ship updates run in each LOD tier
+} GameStats;
+
+// Entity groups kept in the broad phase, used to cull drawing to the view
+typedef enum {
+    CULL_COINS,
+    CULL_ASTEROIDS,
+    CULL_STATIONS,
+    CULL_AI_SHIPS
+} CullGroup;
+
+GameConfig GetDefaultGameConfig(void);
+// Starts a game with player 0 in it, more players join with AddPlayer
+void InitGame(GameConfig config);
+// Starts over with every player in the game, side by side
+void ResetGame(void);
+// Puts a ship in slot id, next to the players still flying or at the start
+// if none are. Joining a game that is over waits for the restart. False if
+// the slot is taken.
+bool AddPlayer(int id);
+void RemovePlayer(int id);
+void SavePreviousState(void);
+// Advances one tick, inputs holds one input for each of the MAX_PLAYERS slots
+void UpdateGamePlayers(const unsigned int* inputs, float deltaTime);
+// Advances one tick with input for player 0 alone, for single player games
+void UpdateGame(unsigned int input, float deltaTime);
+void UnloadGame(void);
+
+const Player* GetPlayer(int id);
+const CoinPool* GetCoins(void);
+const AsteroidPool* GetAsteroids(void);
+const BeamPool* GetBeams(void);
+const Station* GetStations(void);
+const FlowField* GetFlowField(void);
+int GetScore(void);
+// True once every player in the game has crashed
+bool IsGameOver(void);
+// What player id crashed into, NULL while it is flying
+const char* GetCrashReason(int id);
+GameEvents ConsumeGameEvents(void);
+GameStats GetGameStats(void);
+GameConfig GetGameConfig(void);
+
+// Memory holding the simulation state, for snapshots. Returns how many
+// regions were written, or -1 if maxRegions is too small.
+int GetGameStateRegions(StateRegion* regions, int maxRegions);
+// Rebuilds what the regions do not hold, call after overwriting them
+void RestoreGameState(void);
+
+// Writes the ids of entities in group that may overlap view: pool indices,
+// or handles for AI ships. The broad phase lags the drawn positions by up
+// to a tick, callers should still test the exact position they draw at.
+int QueryVisibleEntities(CullGroup group, Rectangle view, int* results, int maxResults);
+
+#endif // GAME_H
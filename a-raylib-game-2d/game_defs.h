@@ -5,12 +5,56 @@
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 450
 
+// Simulation timing, speeds below are tuned in units per 60 Hz tick
+#ifndef SIM_TICK_RATE
+#define SIM_TICK_RATE 60
+#endif
+#define SIM_DT (1.0f / SIM_TICK_RATE)
+#define SIM_TICK_SCALE (60.0f / SIM_TICK_RATE)
+#define SIM_MAX_TICKS_PER_FRAME 16
+#define SIM_FAST_FORWARD_SPEED 4.0f
+
 // Player definitions
 #define BEAM_SIZE 4
 #define PLAYER_SIZE 30
+#define PLAYER_SPEED 5
+#define PLAYER_SPEED_DIAGONAL (PLAYER_SPEED * 0.707f) // For smoother diagonal movement
+#define PLAYER_BASE_ROTATION 0.0f  // 0 degrees
+#define PLAYER_MAX_HEALTH 100
+#define BEAM_SPEED 10.0f
+#define BEAM_LIFETIME 0.5f
+#define SHOOT_COOLDOWN 0.2f
+#define MAX_PLAYERS 32           // Ships in one world, each flown by its own input
+#define PLAYER_SPAWN_SPACING 60  // Between ships that start side by side
+
+// World object definitions, the pool sizes can be raised at build time
+#ifndef MAX_COINS
+#define MAX_COINS 96
+#endif
+#ifndef MAX_ASTEROIDS
+#define MAX_ASTEROIDS 160
+#endif
+#ifndef MAX_BEAMS
+#define MAX_BEAMS 20
+#endif
+#define COIN_SIZE 20
+#define COIN_SPEED 2
+#define ASTEROID_SPEED 2
+#define ASTEROID_MIN_SIZE 20
+#define ASTEROID_MAX_SIZE 40
+#define ASTEROID_HITS 3
+#define ASTEROID_DAMAGE 25
+#define ASTEROID_FRAGMENTS 3              // Pieces a destroyed asteroid breaks into
+#define ASTEROID_FRAGMENT_SCALE 0.55f     // Size of a piece next to its parent
+#define ASTEROID_FRAGMENT_MIN_SIZE 10     // Smaller pieces are not spawned
+#define ASTEROID_FRAGMENT_SPEED 1.5f      // Push away from the parent, per tick at 60 Hz
+#define ASTEROID_FRAGMENT_HITS 1          // Hits a piece takes
+#define ASTEROID_RESTITUTION 1.0f         // 1 keeps asteroid collisions perfectly elastic
 
 // AI ship definitions
+#ifndef MAX_AI_SHIPS
 #define MAX_AI_SHIPS 3
+#endif
 #define AI_SHIP_SIZE 30
 #define AI_PATROL_RADIUS 300
 #define AI_CHASE_RANGE 400
@@ -19,15 +63,76 @@
 #define AI_ROTATION_SPEED 3
 #define AI_SHOOT_COOLDOWN 1.0f
 #define AI_MAX_HEALTH 100
+// State machine thresholds, distances are compared squared
+#define AI_CHASE_RANGE_SQR ((float)AI_CHASE_RANGE * AI_CHASE_RANGE)
+#define AI_CHASE_GIVE_UP_RANGE_SQR ((AI_CHASE_RANGE * 1.2f) * (AI_CHASE_RANGE * 1.2f))
+#define AI_ATTACK_RANGE_SQR ((float)AI_ATTACK_RANGE * AI_ATTACK_RANGE)
+#define AI_RETREAT_HEALTH (AI_MAX_HEALTH * 0.3f)
+#define AI_RECOVERED_HEALTH (AI_MAX_HEALTH * 0.5f)
+// Flocking, ships steer by the neighbours within AI_FLOCK_RADIUS
+#define AI_FLOCK_RADIUS 50
+#define AI_FLOCK_MAX_NEIGHBOURS 8      // Caps the work per ship in dense clumps
+#define AI_SEPARATION_DISTANCE AI_SHIP_SIZE
+#define AI_SEPARATION_WEIGHT 1.5f
+#define AI_ALIGNMENT_WEIGHT 0.3f
+#define AI_COHESION_WEIGHT 0.2f
+// Level of detail, near ships run every tick and the rest every N ticks
+#define AI_LOD_NEAR_RANGE 1000  // Covers the view and every chase range
+#define AI_LOD_MID_RANGE 2500
+#define AI_LOD_MID_PERIOD 4
+#define AI_LOD_FAR_PERIOD 16
 
 // AI beam definitions
+#ifndef MAX_AI_BEAMS
 #define MAX_AI_BEAMS 20
+#endif
 #define AI_BEAM_SPEED 8.0f
 #define AI_BEAM_LIFETIME 1.0f
 #define AI_BEAM_SIZE 4
 
+// Station definitions
+#define MAX_STATIONS 32           // At most one per loaded chunk
+#define MIN_STATION_DISTANCE 500  // Minimum distance between stations
+#define STATION_MIN_SIZE 120
+#define STATION_MAX_SIZE 180
+
+// World streaming, the world is cut into square chunks that are generated
+// from the seed when the player gets close and dropped again behind them
+#define CHUNK_SIZE 1024
+#define CHUNK_LOAD_RADIUS 2             // Loaded chunks around the window center, 5x5
+#define CHUNK_PREFETCH_RADIUS (CHUNK_LOAD_RADIUS + 1)  // Generated ahead in the background
+#define CHUNK_MAX_ASTEROIDS 256
+#define CHUNK_ASTEROID_SPACING 48       // Closest two asteroids start, fits about 380 per chunk
+#define CHUNK_ASTEROID_OVERFILL 3       // Asteroid spacing leaves room for this many times the count
+#define CHUNK_MAX_COINS 64
+#define CHUNK_STATION_CHANCE 25         // Percent of chunks with a station
+#define CHUNK_CACHE_SLOTS 64            // Holds the 7x7 prefetch area with room to spare
+#define CHUNK_RECORD_CAPACITY 1024      // Chunks whose changes are remembered
+#define CHUNK_STORE_CAPACITY 2048       // Changed chunks kept compactly once the records are full
+#define CHUNK_SPAWN_CLEARANCE 200       // Nothing appears this close to the player
+#define DEFAULT_ASTEROIDS_PER_CHUNK 4
+#define DEFAULT_COINS_PER_CHUNK 3
+
+// Impacts and explosions remembered between ConsumeGameEvents calls
+#define MAX_GAME_EFFECTS 64
+#define MAX_GAME_SHOTS 32  // AI shots kept for sound, the nearest ones win
+
+// Broad phase definitions
+#define LARGEST_ENTITY_RADIUS (STATION_MAX_SIZE / 2)
+#define SPATIAL_HASH_CELL_SIZE ((WORLD_SIZE / 16) > (LARGEST_ENTITY_RADIUS * 2) ? \
+                                (WORLD_SIZE / 16) : (LARGEST_ENTITY_RADIUS * 2))
+#define SPATIAL_HASH_BUCKETS 4096  // Must be a power of two
+#define CULL_MARGIN 48  // Covers a tick of motion and sprite corners past the collision radius
+
+// AI navigation, a grid of FLOW_FIELD_SIZE^2 cells centered on the player
+#define FLOW_FIELD_SIZE 64
+#define FLOW_FIELD_CELL_SIZE 40
+#define FLOW_FIELD_REFRESH_TICKS (SIM_TICK_RATE / 4)  // Picks up drifting asteroids
+#define FLOW_FIELD_CLEARANCE (AI_SHIP_SIZE / 2)       // Added to obstacle radii
+
 // Damage definitions
 #define AI_BEAM_DAMAGE 10
 #define AI_COLLISION_DAMAGE 25
+#define PLAYER_BEAM_DAMAGE 20
 
 #endif // GAME_DEFS_H 
\ No newline at end of file
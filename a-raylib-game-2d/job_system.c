@@ -0,0 +1,191 @@
+#include "job_system.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+typedef struct {
+    int start;
+    int end;
+} JobRange;
+
+// The owner pops from the tail, thieves take from the head
+typedef struct {
+    pthread_mutex_t lock;
+    JobRange jobs[JOB_QUEUE_CAPACITY];
+    int head;
+    int tail;
+} JobQueue;
+
+static JobQueue queues[MAX_JOB_WORKERS];
+static pthread_t threads[MAX_JOB_WORKERS];
+static int workerCount = 1;
+static bool initialized = false;
+
+static pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeCond = PTHREAD_COND_INITIALIZER;
+static unsigned int generation = 0;
+static bool quitting = false;
+
+// Set before any range of a loop is queued, read after one is taken
+static JobFunc currentFunc;
+static void* currentContext;
+static atomic_int pendingJobs;
+
+static bool PopJob(JobQueue* queue, JobRange* job) {
+    bool found = false;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail > queue->head) {
+        *job = queue->jobs[--queue->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool StealJob(JobQueue* queue, JobRange* job) {
+    bool found = false;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail > queue->head) {
+        *job = queue->jobs[queue->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool TakeJob(int worker, JobRange* job) {
+    if (PopJob(&queues[worker], job)) return true;
+
+    for (int i = 1; i < workerCount; i++) {
+        if (StealJob(&queues[(worker + i) % workerCount], job)) return true;
+    }
+    return false;
+}
+
+// Runs ranges until every queue is empty
+static void RunJobs(int worker) {
+    JobRange job;
+    while (TakeJob(worker, &job)) {
+        currentFunc(currentContext, job.start, job.end, worker);
+        atomic_fetch_sub_explicit(&pendingJobs, 1, memory_order_release);
+    }
+}
+
+static void* WorkerMain(void* arg) {
+    int worker = (int)(intptr_t)arg;
+    pthread_mutex_lock(&wakeLock);
+    unsigned int seen = generation;
+    while (true) {
+        while (generation == seen && !quitting) {
+            pthread_cond_wait(&wakeCond, &wakeLock);
+        }
+        if (quitting) break;
+        seen = generation;
+        pthread_mutex_unlock(&wakeLock);
+
+        RunJobs(worker);
+
+        pthread_mutex_lock(&wakeLock);
+    }
+    pthread_mutex_unlock(&wakeLock);
+    return NULL;
+}
+
+void InitJobSystem(int count) {
+    if (initialized) ShutdownJobSystem();
+
+    if (count <= 0) count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    if (count > MAX_JOB_WORKERS) count = MAX_JOB_WORKERS;
+
+    for (int i = 0; i < MAX_JOB_WORKERS; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+        queues[i].head = 0;
+        queues[i].tail = 0;
+    }
+
+    quitting = false;
+    workerCount = 1;
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&threads[i], NULL, WorkerMain, (void*)(intptr_t)i) != 0) break;
+        workerCount++;
+    }
+    initialized = true;
+}
+
+void ShutdownJobSystem(void) {
+    if (!initialized) return;
+
+    pthread_mutex_lock(&wakeLock);
+    quitting = true;
+    pthread_cond_broadcast(&wakeCond);
+    pthread_mutex_unlock(&wakeLock);
+
+    for (int i = 1; i < workerCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int i = 0; i < MAX_JOB_WORKERS; i++) {
+        pthread_mutex_destroy(&queues[i].lock);
+    }
+
+    workerCount = 1;
+    initialized = false;
+}
+
+int GetJobWorkerCount(void) {
+    return workerCount;
+}
+
+void ParallelFor(int count, int grainSize, JobFunc func, void* context) {
+    if (count <= 0) return;
+    if (grainSize < 1) grainSize = 1;
+
+    // Not worth waking anyone up
+    if (workerCount == 1 || count <= grainSize) {
+        func(context, 0, count, 0);
+        return;
+    }
+
+    int maxJobs = workerCount * JOB_QUEUE_CAPACITY;
+    int jobCount = (count + grainSize - 1) / grainSize;
+    if (jobCount > maxJobs) {
+        grainSize = (count + maxJobs - 1) / maxJobs;
+        jobCount = (count + grainSize - 1) / grainSize;
+    }
+
+    currentFunc = func;
+    currentContext = context;
+    atomic_store_explicit(&pendingJobs, jobCount, memory_order_relaxed);
+
+    // Deal neighbouring ranges to the same worker, stealing evens out the rest
+    for (int w = 0; w < workerCount; w++) {
+        JobQueue* queue = &queues[w];
+        int first = (int)((long long)jobCount * w / workerCount);
+        int last = (int)((long long)jobCount * (w + 1) / workerCount);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->head = 0;
+        queue->tail = 0;
+        for (int j = last - 1; j >= first; j--) {
+            int start = j * grainSize;
+            int end = start + grainSize < count ? start + grainSize : count;
+            queue->jobs[queue->tail++] = (JobRange){ start, end };
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    pthread_mutex_lock(&wakeLock);
+    generation++;
+    pthread_cond_broadcast(&wakeCond);
+    pthread_mutex_unlock(&wakeLock);
+
+    RunJobs(0);
+
+    // Wait for ranges other workers are still running
+    while (atomic_load_explicit(&pendingJobs, memory_order_acquire) > 0) {
+        sched_yield();
+    }
+}
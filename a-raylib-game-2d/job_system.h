@@ -0,0 +1,24 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+// Small work-stealing thread pool for splitting loops over entity pools.
+// A parallel loop is cut into ranges that are dealt out to per-worker
+// queues; workers drain their own queue first and then steal from the
+// others. The calling thread takes part as worker 0 and does not return
+// until every range has run.
+
+#define MAX_JOB_WORKERS 16
+#define JOB_QUEUE_CAPACITY 256
+
+// Runs over [start, end), worker is in [0, GetJobWorkerCount())
+typedef void (*JobFunc)(void* context, int start, int end, int worker);
+
+// Starts workerCount - 1 threads, 0 picks one worker per core
+void InitJobSystem(int workerCount);
+void ShutdownJobSystem(void);
+int GetJobWorkerCount(void);
+
+// Calls func over [0, count) in ranges of at least grainSize and waits for all of them
+void ParallelFor(int count, int grainSize, JobFunc func, void* context);
+
+#endif // JOB_SYSTEM_H
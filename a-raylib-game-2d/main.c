@@ -1,260 +1,427 @@
 #include "raylib.h"
 #include "raymath.h"
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "game_defs.h"
+#include "game.h"
 #include "AI.h"
+#include "spatial_hash.h"
+#include "projectile_kernels.h"
+#include "sprite_batch.h"
+#include "particles.h"
+#include "starfield.h"
+#include "replay.h"
+#include "profiler.h"
+#include "assets.h"
+#include "sound_pool.h"
+#include "snapshot.h"
+#include "net.h"
+#include "net_client.h"
 
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 450
-#define PLAYER_SPEED 5
-#define COIN_SIZE 20
-#define MAX_COINS 5
-#define MAX_ASTEROIDS 8
-#define ASTEROID_SPEED 2
-#define COIN_SPEED 2
-#define WORLD_SIZE 2000
 #define HUD_MARGIN 10
 #define HUD_TEXT_SIZE 16
-#define PLAYER_SPEED_DIAGONAL (PLAYER_SPEED * 0.707f) // For smoother diagonal movement
-#define PLAYER_BASE_ROTATION 0.0f  // 0 degrees
-#define BEAM_SPEED 10.0f
-#define BEAM_LIFETIME 0.5f
-#define ASTEROID_HITS 3
-#define MAX_BEAMS 20
-#define SHOOT_COOLDOWN 0.2f
-#define MAX_STATIONS 5
-#define STATION_MIN_SIZE 120
-#define STATION_MAX_SIZE 180
-#define MIN_STATION_DISTANCE 500  // Minimum distance between stations
-#define PLAYER_MAX_HEALTH 100
 #define HEALTH_BAR_WIDTH 200
 #define HEALTH_BAR_HEIGHT 20
+#define AUDIO_FADE_SPEED 0.1f
+#define LASER_VOLUME 0.6f
+#define AI_LASER_VOLUME 0.4f
+#define IMPACT_PARTICLES 12
+#define EXPLOSION_PARTICLES_PER_UNIT 4  // Per unit of size of what blew up
+#define MOVE_INPUTS (INPUT_LEFT | INPUT_RIGHT | INPUT_UP | INPUT_DOWN)
+#define REWIND_FRAMES 180  // Three seconds of snapshots at 60 FPS
+#define QUICKSAVE_PATH "quicksave.snap"
+#define LOADING_BAR_WIDTH 300
+#define LOADING_BAR_HEIGHT 12
+#define PROFILER_GRAPH_HEIGHT 60
+#define PROFILER_GRAPH_MS 33.3f    // Frame time at the top of the graph
+#define PROFILER_BUDGET_MS 16.7f   // One frame at 60 FPS, drawn as a line
+#define PROFILER_LINE_HEIGHT 11
+#define AI_SHIP_TINT RED
+
+typedef enum {
+    REPLAY_MODE_NONE,
+    REPLAY_MODE_RECORD,  // --record <file>, saved on exit
+    REPLAY_MODE_PLAY     // --play <file>, input comes from the file
+} ReplayMode;
 
-typedef struct {
-    Vector2 position;
-    float size;
-    Color color;
-    Texture2D texture;
-    float rotation;
-    float health;
-} Player;
-
-typedef struct {
-    Vector2 position;
-    Vector2 velocity;
-    bool active;
-    Texture2D texture;
-} Coin;
-
-typedef struct {
-    Vector2 position;
-    Vector2 velocity;
-    float size;
-    bool active;
-    Texture2D texture;
-    int hits;
-} Asteroid;
-
-typedef struct {
-    Vector2 position;
-    Vector2 velocity;
-    float lifetime;
-    bool active;
-} Beam;
-
-typedef struct {
-    Vector2 position;
-    float size;
-    bool active;
-    Texture2D texture;
-} Station;
-
-static Player player;
-static Coin coins[MAX_COINS];
-static Asteroid asteroids[MAX_ASTEROIDS];
 static Camera2D camera = { 0 };
 static bool gamePaused = false;
-static int score = 0;
-static bool gameOver = false;
-static Texture2D jetEffect;
-static Texture2D beamEffect;
 static Sound engineSound;
 static Sound engineBoostSound;
 static Sound laserSound;
-static Beam beams[MAX_BEAMS];
-static float shootTimer = 0.0f;
+static AssetHandle engineAsset;
+static AssetHandle engineBoostAsset;
+static AssetHandle laserAsset;
 static float engineVolume = 0.0f;
 static bool engineSoundPlaying = false;
-static Station stations[MAX_STATIONS];
-static Texture2D stationTexture;
-#define AUDIO_FADE_SPEED 0.1f
-static const char* crashReason = NULL;
-
-Vector2 GetRandomSpawnPosition(void) {
-    Vector2 pos;
-    float spawnDistance = WINDOW_WIDTH;  // Distance from camera view to spawn
-    float angle = GetRandomValue(0, 360) * DEG2RAD;
-    
-    pos.x = player.position.x + cosf(angle) * spawnDistance;
-    pos.y = player.position.y + sinf(angle) * spawnDistance;
-    
-    return pos;
+static float simAccumulator = 0.0f;
+static float simSpeed = 1.0f;
+static float jetParticleCarry = 0.0f;  // Fraction of a jet particle owed from last frame
+static Replay replay = { 0 };
+static ReplayMode replayMode = REPLAY_MODE_NONE;
+static const char* replayPath = NULL;
+static bool replayEnded = false;
+static bool profilerVisible = false;
+static Snapshot rewindFrames[REWIND_FRAMES];  // Ring of the state after each frame, the newest is on screen
+static int rewindHead = 0;                     // Slot the next frame goes into
+static int rewindCount = 0;
+static const char* tracePath = NULL;
+static int netPort = 0;  // --connect <port>, the server owns the simulation
+static int localPlayer = 0;  // Ship on screen, the server picks it when connected
+
+// Atlas sprite for each texture id the simulation hands out
+static const SpriteId textureSprites[TEXTURE_COUNT] = {
+    [TEXTURE_SHIP] = SPRITE_SHIP,
+    [TEXTURE_GOLD] = SPRITE_GOLD,
+    [TEXTURE_ASTEROID] = SPRITE_ASTEROID,
+    [TEXTURE_JET] = SPRITE_JET,
+    [TEXTURE_BEAM] = SPRITE_BEAM,
+    [TEXTURE_STATION] = SPRITE_STATION
+};
+
+// Scratch space for broad phase view queries, big enough for any one pool
+#define MAX_VISIBLE_IDS (MAX_ASTEROIDS + MAX_COINS + MAX_STATIONS + MAX_AI_SHIPS)
+static int visibleIds[MAX_VISIBLE_IDS];
+
+// True if a square sprite of the given size centered at position overlaps view
+static bool IsSpriteVisible(Rectangle view, Vector2 position, float size) {
+    Rectangle bounds = { position.x - size/2, position.y - size/2, size, size };
+    return CheckCollisionRecs(bounds, view);
 }
 
-void ResetGame(void) {
-    player.position = (Vector2){WINDOW_WIDTH/2, WINDOW_HEIGHT/2};
-    player.rotation = PLAYER_BASE_ROTATION;
-    score = 0;
-    gameOver = false;
-
-    // Reset coins
-    for (int i = 0; i < MAX_COINS; i++) {
-        coins[i].position = GetRandomSpawnPosition();
-        coins[i].velocity = (Vector2){
-            GetRandomValue(-COIN_SPEED, COIN_SPEED),
-            GetRandomValue(-COIN_SPEED, COIN_SPEED)
-        };
-        coins[i].active = true;
-    }
+// Queues the ship and its health bar, false if it is dead or off screen
+static bool DrawAIShip(int handle, float alpha, Rectangle view) {
+    if (!IsAIShipActive(handle)) return false;
+
+    Vector2 position = Vector2Lerp(GetAIShipPreviousPosition(handle), GetAIShipPosition(handle), alpha);
+
+    // The health bar sits a full ship size above the center
+    Rectangle bounds = {
+        position.x - AI_SHIP_SIZE,
+        position.y - AI_SHIP_SIZE,
+        AI_SHIP_SIZE * 2,
+        AI_SHIP_SIZE * 2
+    };
+    if (!CheckCollisionRecs(bounds, view)) return false;
+
+    // Draw health bar, the green part shrinks from the right
+    float healthPercentage = GetAIShipHealth(handle) / AI_MAX_HEALTH;
+    float healthBarY = position.y - AI_SHIP_SIZE + 2.5f;
+    DrawSprite(SPRITE_WHITE, SPRITE_LAYER_OVERLAY,
+        (Vector2){ position.x, healthBarY },
+        (Vector2){ AI_SHIP_SIZE, 5 }, 0, RED);
+    DrawSprite(SPRITE_WHITE, SPRITE_LAYER_OVERLAY,
+        (Vector2){ position.x - AI_SHIP_SIZE * (1 - healthPercentage) / 2, healthBarY },
+        (Vector2){ AI_SHIP_SIZE * healthPercentage, 5 }, 0, GREEN);
+
+    // Draw ship
+    DrawSprite(SPRITE_AI_SHIP, SPRITE_LAYER_ENEMIES, position,
+        (Vector2){ AI_SHIP_SIZE, AI_SHIP_SIZE },
+        GetAIShipRotation(handle), AI_SHIP_TINT);
+    return true;
+}
+
+// Returns the beams drawn
+static int DrawAIBeams(float alpha, Rectangle view) {
+    int drawn = 0;
+    for (int i = 0; i < GetAIBeamCount(); i++) {
+        Vector2 position = Vector2Lerp(GetAIBeamPreviousPosition(i), GetAIBeamPosition(i), alpha);
+        if (!CheckCollisionCircleRec(position, AI_BEAM_SIZE/2, view)) continue;
 
-    // Reset beams
-    for (int i = 0; i < MAX_BEAMS; i++) {
-        beams[i].active = false;
+        DrawSprite(SPRITE_CIRCLE, SPRITE_LAYER_ENEMIES, position,
+            (Vector2){ AI_BEAM_SIZE, AI_BEAM_SIZE }, 0, RED);
+        drawn++;
     }
+    return drawn;
+}
+
+// Another player's ship in its own colour, with a jet while its last input
+// moved it. Returns whether it was drawn.
+static bool DrawOtherPlayer(const Player* other, float alpha, Rectangle view) {
+    if (!other->active || !other->alive) return false;
 
-    // Reset asteroids with hits
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        asteroids[i].position = GetRandomSpawnPosition();
-        asteroids[i].velocity = (Vector2){
-            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED),
-            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED)
+    Vector2 position = Vector2Lerp(other->prevPosition, other->position, alpha);
+    if (!IsSpriteVisible(view, position, other->size * 2)) return false;
+
+    if (other->input & MOVE_INPUTS) {
+        float offsetDistance = other->size * 0.75f;
+        Vector2 jetPos = {
+            position.x + cosf((other->rotation + 90) * DEG2RAD) * offsetDistance,
+            position.y + sinf((other->rotation + 90) * DEG2RAD) * offsetDistance
         };
-        asteroids[i].size = GetRandomValue(20, 40);
-        asteroids[i].active = true;
-        asteroids[i].hits = 0;
+        DrawSprite(textureSprites[TEXTURE_JET], SPRITE_LAYER_PLAYER, jetPos,
+            (Vector2){ other->size, other->size }, other->rotation, WHITE);
     }
+    DrawSprite(textureSprites[TEXTURE_SHIP], SPRITE_LAYER_PLAYER, position,
+        (Vector2){ other->size, other->size }, other->rotation, other->color);
+    return true;
+}
 
-    // Reset stations
-    for (int i = 0; i < MAX_STATIONS; i++) {
-        do {
-            stations[i].position = GetRandomSpawnPosition();
-            // Check distance from other stations
-            bool tooClose = false;
-            for (int j = 0; j < i; j++) {
-                if (Vector2Distance(stations[i].position, stations[j].position) < MIN_STATION_DISTANCE) {
-                    tooClose = true;
-                    break;
-                }
-            }
-            if (!tooClose) break;
-        } while (1);
-        
-        stations[i].size = GetRandomValue(STATION_MIN_SIZE, STATION_MAX_SIZE);
-        stations[i].active = true;
+// Turns the impacts and explosions of the last ticks into particles
+static void EmitEffectParticles(const GameEvents* events) {
+    for (int e = 0; e < events->effectCount; e++) {
+        const GameEffect* effect = &events->effects[e];
+        if (effect->type == EFFECT_IMPACT) {
+            // Sparks fly back the way the beam came
+            Vector2 back = { -effect->direction.x, -effect->direction.y };
+            EmitParticles(PARTICLE_IMPACT, effect->position, back, IMPACT_PARTICLES);
+        } else {
+            EmitParticles(PARTICLE_EXPLOSION, effect->position, (Vector2){ 1, 0 },
+                (int)(effect->size * EXPLOSION_PARTICLES_PER_UNIT));
+        }
+    }
+}
+
+// Exhaust out of the back of the ship, thinning out with the engine sound
+static void EmitJetParticles(const Player* player, float frameTime) {
+    jetParticleCarry += JET_PARTICLES_PER_SECOND * engineVolume * frameTime;
+    int amount = (int)jetParticleCarry;
+    if (amount == 0) return;
+    jetParticleCarry -= amount;
+
+    Vector2 back = {
+        cosf((player->rotation + 90) * DEG2RAD),
+        sinf((player->rotation + 90) * DEG2RAD)
+    };
+    Vector2 nozzle = Vector2Add(player->position, Vector2Scale(back, player->size * 0.5f));
+    EmitParticles(PARTICLE_JET, nozzle, back, amount);
+}
+
+// Samples the keyboard into the input flags the simulation understands
+unsigned int ReadPlayerInput(void) {
+    unsigned int input = 0;
+    if (IsKeyDown(KEY_LEFT)) input |= INPUT_LEFT;
+    if (IsKeyDown(KEY_RIGHT)) input |= INPUT_RIGHT;
+    if (IsKeyDown(KEY_UP)) input |= INPUT_UP;
+    if (IsKeyDown(KEY_DOWN)) input |= INPUT_DOWN;
+    if (IsKeyDown(KEY_SPACE)) input |= INPUT_FIRE;
+    return input;
+}
+
+// Picks up --record <file>, --play <file>, --trace <file> and --connect <port>
+static void ParseArguments(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            replayMode = REPLAY_MODE_RECORD;
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--play") == 0) {
+            replayMode = REPLAY_MODE_PLAY;
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--connect") == 0) {
+            netPort = atoi(argv[++i]);
+            if (netPort <= 0) netPort = NET_DEFAULT_PORT;
+        }
     }
+}
 
-    player.health = PLAYER_MAX_HEALTH;
+// Progress bar shown while the asset cache decodes in the background
+static void DrawLoadingScreen(float progress) {
+    int x = (WINDOW_WIDTH - LOADING_BAR_WIDTH) / 2;
+    int y = WINDOW_HEIGHT / 2;
+    const char* text = TextFormat("Loading %d%%", (int)(progress * 100));
+
+    DrawText(text, (WINDOW_WIDTH - MeasureText(text, 20)) / 2, y - 30, 20, WHITE);
+    DrawRectangle(x, y, LOADING_BAR_WIDTH, LOADING_BAR_HEIGHT, DARKGRAY);
+    DrawRectangle(x, y, (int)(LOADING_BAR_WIDTH * progress), LOADING_BAR_HEIGHT, GREEN);
+}
+
+// Rolling frame time graph with percentiles and the average cost of each
+// zone, under the health bar
+static void DrawProfilerOverlay(void) {
+    float frameMs[PROFILE_HISTORY];
+    int frames = GetProfileFrameTimes(frameMs, PROFILE_HISTORY);
+
+    int x = WINDOW_WIDTH - PROFILE_HISTORY - HUD_MARGIN;
+    int y = HUD_MARGIN * 2 + HEALTH_BAR_HEIGHT;
+    int height = 3 * PROFILER_LINE_HEIGHT + PROFILER_GRAPH_HEIGHT + PROFILE_ZONE_COUNT * PROFILER_LINE_HEIGHT;
+    DrawRectangle(x - 5, y - 5, PROFILE_HISTORY + 10, height + 10, Fade(BLACK, 0.6f));
+
+    // One column per frame, newest on the right
+    int graphBottom = y + PROFILER_GRAPH_HEIGHT;
+    for (int i = 0; i < frames; i++) {
+        float ms = frameMs[i];
+        int barHeight = (int)(fminf(ms / PROFILER_GRAPH_MS, 1.0f) * PROFILER_GRAPH_HEIGHT);
+        Color color = ms <= PROFILER_BUDGET_MS ? GREEN : (ms <= PROFILER_GRAPH_MS ? YELLOW : RED);
+        DrawRectangle(x + PROFILE_HISTORY - frames + i, graphBottom - barHeight, 1, barHeight, color);
+    }
+    int budgetY = graphBottom - (int)(PROFILER_BUDGET_MS / PROFILER_GRAPH_MS * PROFILER_GRAPH_HEIGHT);
+    DrawLine(x, budgetY, x + PROFILE_HISTORY, budgetY, Fade(WHITE, 0.5f));
+
+    int textY = graphBottom + 4;
+    DrawText(TextFormat("Frame p50 %.2f ms, p99 %.2f ms",
+        GetProfileFramePercentile(0.5f), GetProfileFramePercentile(0.99f)),
+        x, textY, 10, WHITE);
+    textY += PROFILER_LINE_HEIGHT * 2;
+
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        DrawText(TextFormat("%-16s %6.3f ms", GetProfileZoneName(z), GetProfileZoneAverage(z)),
+            x, textY, 10, LIGHTGRAY);
+        textY += PROFILER_LINE_HEIGHT;
+    }
 }
 
-int main(void) {
+int main(int argc, char** argv) {
+    ParseArguments(argc, argv);
+
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Space Collector");
     InitAudioDevice();
-    InitAI();
-    InitAIBeams();
     SetTargetFPS(60);
 
-    // Load textures
-    Texture2D backgroundTexture = LoadTexture("assets/background/background.jpg");
-    Texture2D shipTexture = LoadTexture("assets/ship/ship.png");
-    Texture2D goldTexture = LoadTexture("assets/gold/gold.png");
-    Texture2D asteroidTexture = LoadTexture("assets/asteroids/asteroid-pixel-1.png");
-    jetEffect = LoadTexture("assets/effects/jet.png");
-    beamEffect = LoadTexture("assets/effects/beam.png");
-    stationTexture = LoadTexture("assets/stations/station1.png");
+    // Decode everything on the loader threads, every sprite ends up in the
+    // atlas
+    InitAssets();
+    engineAsset = RequestAsset(ASSET_SOUND, "assets/sounds/engine_idle.wav");
+    engineBoostAsset = RequestAsset(ASSET_SOUND, "assets/sounds/engine_boost.wav");
+    laserAsset = RequestAsset(ASSET_SOUND, "assets/sounds/laser_shoot.wav");
+    RequestSpriteAtlas();
 
-    // Load sounds
-    engineSound = LoadSound("assets/sounds/engine_idle.wav");
-    engineBoostSound = LoadSound("assets/sounds/engine_boost.wav");
-    laserSound = LoadSound("assets/sounds/laser_shoot.wav");
+    while (!UpdateAssets() && !WindowShouldClose()) {
+        BeginDrawing();
+        ClearBackground(BLACK);
+        DrawLoadingScreen(GetAssetProgress());
+        EndDrawing();
+    }
+
+    LoadSpriteAtlas();
+    LoadStarfield();
+    engineSound = GetAssetSound(engineAsset);
+    engineBoostSound = GetAssetSound(engineBoostAsset);
+    laserSound = GetAssetSound(laserAsset);
 
     // Set sound volume
     SetSoundVolume(engineSound, 0.5f);
     SetSoundVolume(engineBoostSound, 0.7f);
-    SetSoundVolume(laserSound, 0.6f);
-
-    // Initialize player
-    player = (Player){
-        .position = (Vector2){WINDOW_WIDTH/2, WINDOW_HEIGHT/2},
-        .size = 30,
-        .color = RED,
-        .texture = shipTexture,
-        .rotation = PLAYER_BASE_ROTATION,
-        .health = PLAYER_MAX_HEALTH
-    };
+    InitSoundPool();
+
+    // Initialize game objects and player
+    GameConfig config = GetDefaultGameConfig();
+    config.seed = (unsigned int)GetRandomValue(0, 0x7fffffff);
+    if (netPort != 0 && replayMode != REPLAY_MODE_NONE) {
+        TraceLog(LOG_WARNING, "NET: Replays are not recorded or played while connected");
+        replayMode = REPLAY_MODE_NONE;
+    }
+    if (replayMode == REPLAY_MODE_PLAY) {
+        if (LoadReplay(&replay, replayPath)) {
+            config = replay.info.config;
+        } else {
+            TraceLog(LOG_WARNING, "REPLAY: Could not load %s", replayPath);
+            replayMode = REPLAY_MODE_NONE;
+        }
+    }
+    InitGame(config);
+    if (replayMode == REPLAY_MODE_RECORD) {
+        BeginReplayRecording(&replay, config);
+    }
+    if (netPort != 0 && !ConnectNetClient(netPort)) {
+        TraceLog(LOG_WARNING, "NET: Could not open a socket, playing offline");
+        netPort = 0;
+    }
+    if (tracePath != NULL && !BeginProfileCapture(tracePath)) {
+        TraceLog(LOG_WARNING, "PROFILER: Could not write %s", tracePath);
+    }
 
     // Initialize camera
     camera.offset = (Vector2){ WINDOW_WIDTH/2.0f, WINDOW_HEIGHT/2.0f };
-    camera.target = player.position;
+    camera.target = GetPlayer(0)->position;
     camera.rotation = 0.0f;
     camera.zoom = 1.0f;
 
-    // Initialize game objects
-    for (int i = 0; i < MAX_COINS; i++) {
-        coins[i].position = GetRandomSpawnPosition();
-        coins[i].velocity = (Vector2){
-            GetRandomValue(-COIN_SPEED, COIN_SPEED),
-            GetRandomValue(-COIN_SPEED, COIN_SPEED)
-        };
-        coins[i].active = true;
-        coins[i].texture = goldTexture;
-    }
-
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        asteroids[i].position = GetRandomSpawnPosition();
-        asteroids[i].velocity = (Vector2){
-            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED),
-            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED)
-        };
-        asteroids[i].size = GetRandomValue(20, 40);
-        asteroids[i].active = true;
-        asteroids[i].texture = asteroidTexture;
-    }
-
-    for (int i = 0; i < MAX_STATIONS; i++) {
-        do {
-            stations[i].position = GetRandomSpawnPosition();
-            bool tooClose = false;
-            for (int j = 0; j < i; j++) {
-                if (Vector2Distance(stations[i].position, stations[j].position) < MIN_STATION_DISTANCE) {
-                    tooClose = true;
-                    break;
-                }
-            }
-            if (!tooClose) break;
-        } while (1);
-        
-        stations[i].size = GetRandomValue(STATION_MIN_SIZE, STATION_MAX_SIZE);
-        stations[i].active = true;
-        stations[i].texture = stationTexture;
-    }
-
     while (!WindowShouldClose()) {
-        float deltaTime = GetFrameTime();
-        shootTimer -= deltaTime;
+        BeginProfileFrame();
+        float frameTime = GetFrameTime();
         bool isMoving = false;  // Declare at start of loop
 
-        if (gameOver && IsKeyPressed(KEY_ENTER)) {
+        // The newest server snapshot replaces the simulation before this
+        // frame's ticks, and says which ship is ours
+        if (netPort != 0) {
+            PollNetClient();
+            if (GetNetClientPlayer() >= 0) localPlayer = GetNetClientPlayer();
+        }
+
+        const Player* player = GetPlayer(localPlayer);
+        const CoinPool* coins = GetCoins();
+        const AsteroidPool* asteroids = GetAsteroids();
+        const BeamPool* beams = GetBeams();
+        const Station* stations = GetStations();
+
+        if (IsGameOver() && netPort != 0) {
+            if (IsKeyPressed(KEY_ENTER)) RequestNetRestart();
+        } else if (IsGameOver() && replayMode == REPLAY_MODE_PLAY && !replayEnded) {
+            // The recorded player restarted here, or the recording stops
+            unsigned int unused;
+            if (NextReplayStep(&replay, &unused) == REPLAY_STEP_RESET) {
+                ResetGame();
+                ClearParticles();
+            } else {
+                replayEnded = true;
+            }
+        } else if (IsGameOver() && replayMode != REPLAY_MODE_PLAY && IsKeyPressed(KEY_ENTER)) {
             ResetGame();
+            ClearParticles();
+            if (replayMode == REPLAY_MODE_RECORD) RecordReplayReset(&replay);
         }
 
         if (IsKeyPressed(KEY_ESCAPE)) {
             gamePaused = !gamePaused;
         }
 
-        if (!gameOver && !gamePaused) {
+        // Toggle between the broad phase and brute force collision checks,
+        // both find the same hits so only the speed changes
+        if (IsKeyPressed(KEY_F2)) {
+            SetSpatialHashEnabled(!IsSpatialHashEnabled());
+        }
+
+        // Toggle fast-forward, the simulation runs more fixed ticks per frame.
+        // The server keeps its own pace.
+        if (IsKeyPressed(KEY_F3) && netPort == 0) {
+            simSpeed = (simSpeed == 1.0f) ? SIM_FAST_FORWARD_SPEED : 1.0f;
+        }
+
+        // Toggle the profiler overlay
+        if (IsKeyPressed(KEY_F4)) {
+            profilerVisible = !profilerVisible;
+        }
+
+        // Quick save, quick load and rewind. They would take the game out
+        // of step with a replay or the server, so not during one.
+        bool canRewind = replayMode == REPLAY_MODE_NONE && netPort == 0;
+        if (canRewind && IsKeyPressed(KEY_F5)) {
+            Snapshot quicksave = { 0 };
+            if (!CaptureSnapshot(&quicksave) || !SaveSnapshot(&quicksave, QUICKSAVE_PATH)) {
+                TraceLog(LOG_WARNING, "SNAPSHOT: Could not save %s", QUICKSAVE_PATH);
+            }
+            UnloadSnapshot(&quicksave);
+        }
+        if (canRewind && IsKeyPressed(KEY_F9)) {
+            if (LoadSnapshot(QUICKSAVE_PATH)) {
+                ClearParticles();
+                rewindCount = 0;
+                simAccumulator = 0.0f;
+            } else {
+                TraceLog(LOG_WARNING, "SNAPSHOT: Could not load %s", QUICKSAVE_PATH);
+            }
+        }
+
+        // Holding backspace steps back one frame per frame. The newest frame
+        // is the state on screen, so it is dropped and the one before restored.
+        bool rewinding = canRewind && IsKeyDown(KEY_BACKSPACE) && rewindCount > 1;
+        if (rewinding) {
+            rewindHead = (rewindHead + REWIND_FRAMES - 1) % REWIND_FRAMES;
+            rewindCount--;
+            RestoreSnapshot(&rewindFrames[(rewindHead + REWIND_FRAMES - 1) % REWIND_FRAMES]);
+            simAccumulator = 0.0f;
+        }
+
+        if (!IsGameOver() && !gamePaused && !rewinding) {
             // Update isMoving based on input
-            isMoving = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_LEFT) || 
-                       IsKeyDown(KEY_UP) || IsKeyDown(KEY_DOWN);
+            BeginProfileZone(PROFILE_INPUT);
+            unsigned int input = replayMode == REPLAY_MODE_PLAY ? replay.input : ReadPlayerInput();
+            if (!player->alive) input = 0;  // Crashed, the others fly on
+            isMoving = (input & MOVE_INPUTS) != 0;
+            EndProfileZone(PROFILE_INPUT);
 
             // Smooth audio transitions
             if (isMoving) {
@@ -275,329 +442,205 @@ int main(void) {
                 SetSoundVolume(engineSound, engineVolume * 0.5f);
             }
 
-            // Update camera target to follow player
-            camera.target = player.position;
-
-            // Update player movement and rotation
-            if ((IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_LEFT)) && 
-                (IsKeyDown(KEY_UP) || IsKeyDown(KEY_DOWN))) {
-                float moveSpeed = PLAYER_SPEED_DIAGONAL;
-                
-                if (IsKeyDown(KEY_RIGHT)) player.position.x += moveSpeed;
-                if (IsKeyDown(KEY_LEFT)) player.position.x -= moveSpeed;
-                if (IsKeyDown(KEY_UP)) player.position.y -= moveSpeed;
-                if (IsKeyDown(KEY_DOWN)) player.position.y += moveSpeed;
-            } else {
-                if (IsKeyDown(KEY_RIGHT)) player.position.x += PLAYER_SPEED;
-                if (IsKeyDown(KEY_LEFT)) player.position.x -= PLAYER_SPEED;
-                if (IsKeyDown(KEY_UP)) player.position.y -= PLAYER_SPEED;
-                if (IsKeyDown(KEY_DOWN)) player.position.y += PLAYER_SPEED;
-            }
-
-            // Update rotation based on movement
-            if (IsKeyDown(KEY_RIGHT) && !IsKeyDown(KEY_LEFT)) {
-                if (IsKeyDown(KEY_UP)) player.rotation = PLAYER_BASE_ROTATION + 45;
-                else if (IsKeyDown(KEY_DOWN)) player.rotation = PLAYER_BASE_ROTATION + 135;
-                else player.rotation = PLAYER_BASE_ROTATION + 90;
-            }
-            else if (IsKeyDown(KEY_LEFT) && !IsKeyDown(KEY_RIGHT)) {
-                if (IsKeyDown(KEY_UP)) player.rotation = PLAYER_BASE_ROTATION - 45;
-                else if (IsKeyDown(KEY_DOWN)) player.rotation = PLAYER_BASE_ROTATION - 135;
-                else player.rotation = PLAYER_BASE_ROTATION - 90;
-            }
-            else if (IsKeyDown(KEY_UP)) player.rotation = PLAYER_BASE_ROTATION;
-            else if (IsKeyDown(KEY_DOWN)) player.rotation = PLAYER_BASE_ROTATION + 180;
-
-            // Shooting mechanics
-            if (IsKeyDown(KEY_SPACE) && shootTimer <= 0) {
-                for (int i = 0; i < MAX_BEAMS; i++) {
-                    if (!beams[i].active) {
-                        // Calculate beam starting position at front of ship
-                        float offsetDistance = player.size * 0.75f;
-                        beams[i].position.x = player.position.x + cosf((player.rotation - 90) * DEG2RAD) * offsetDistance;
-                        beams[i].position.y = player.position.y + sinf((player.rotation - 90) * DEG2RAD) * offsetDistance;
-                        
-                        // Calculate beam velocity based on ship rotation
-                        float angle = (player.rotation - 90) * DEG2RAD;
-                        beams[i].velocity.x = cosf(angle) * BEAM_SPEED;
-                        beams[i].velocity.y = sinf(angle) * BEAM_SPEED;
-                        
-                        beams[i].lifetime = BEAM_LIFETIME;
-                        beams[i].active = true;
-                        PlaySound(laserSound);
-                        shootTimer = SHOOT_COOLDOWN;
-                        break;
-                    }
+            // Run as many fixed ticks as the elapsed time allows
+            simAccumulator += frameTime * simSpeed;
+            int ticks = 0;
+            while (simAccumulator >= SIM_DT && ticks < SIM_MAX_TICKS_PER_FRAME &&
+                   !IsGameOver() && !replayEnded) {
+                if (replayMode == REPLAY_MODE_PLAY &&
+                    NextReplayStep(&replay, &input) != REPLAY_STEP_TICK) {
+                    replayEnded = true;
+                    break;
                 }
-            }
 
-            // Update beams
-            for (int i = 0; i < MAX_BEAMS; i++) {
-                if (beams[i].active) {
-                    beams[i].position = Vector2Add(beams[i].position, beams[i].velocity);
-                    beams[i].lifetime -= deltaTime;
-
-                    if (beams[i].lifetime <= 0) {
-                        beams[i].active = false;
-                        continue;
-                    }
-
-                    // Check collision with asteroids
-                    for (int j = 0; j < MAX_ASTEROIDS; j++) {
-                        if (asteroids[j].active && 
-                            CheckCollisionCircles(beams[i].position, 4,
-                                               asteroids[j].position, asteroids[j].size/2)) {
-                            beams[i].active = false;
-                            asteroids[j].hits++;
-                            
-                            if (asteroids[j].hits >= ASTEROID_HITS) {
-                                asteroids[j].position = GetRandomSpawnPosition();
-                                asteroids[j].velocity = (Vector2){
-                                    GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED),
-                                    GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED)
-                                };
-                                asteroids[j].hits = 0;
-                                score += 5;  // Bonus points for destroying asteroid
-                            }
-                            break;
-                        }
-                    }
+                if (netPort != 0) {
+                    TickNetClient(input);
+                } else {
+                    SavePreviousState();
+                    UpdateGame(input, SIM_DT);
                 }
+                if (replayMode == REPLAY_MODE_RECORD) RecordReplayTick(&replay, input);
+                simAccumulator -= SIM_DT;
+                ticks++;
             }
 
-            // Update coins and asteroids only when not paused
-            for (int i = 0; i < MAX_COINS; i++) {
-                if (coins[i].active) {
-                    coins[i].position = Vector2Add(coins[i].position, coins[i].velocity);
-                    
-                    float distToPlayer = Vector2Distance(coins[i].position, player.position);
-                    if (distToPlayer > WINDOW_WIDTH * 1.5) {
-                        coins[i].position = GetRandomSpawnPosition();
-                        coins[i].velocity = (Vector2){
-                            GetRandomValue(-COIN_SPEED, COIN_SPEED),
-                            GetRandomValue(-COIN_SPEED, COIN_SPEED)
-                        };
-                    }
-
-                    if (CheckCollisionCircles(player.position, player.size/2,
-                        coins[i].position, COIN_SIZE/2)) {
-                        coins[i].position = GetRandomSpawnPosition();
-                        coins[i].velocity = (Vector2){
-                            GetRandomValue(-COIN_SPEED, COIN_SPEED),
-                            GetRandomValue(-COIN_SPEED, COIN_SPEED)
-                        };
-                        score++;
-                    }
-                }
-            }
+            // Drop time we could not catch up on instead of spiralling
+            if (simAccumulator > SIM_DT) simAccumulator = SIM_DT;
 
-            for (int i = 0; i < MAX_ASTEROIDS; i++) {
-                if (asteroids[i].active) {
-                    asteroids[i].position = Vector2Add(asteroids[i].position, asteroids[i].velocity);
-                    
-                    float distToPlayer = Vector2Distance(asteroids[i].position, player.position);
-                    if (distToPlayer > WINDOW_WIDTH * 1.5) {
-                        asteroids[i].position = GetRandomSpawnPosition();
-                        asteroids[i].velocity = (Vector2){
-                            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED),
-                            GetRandomValue(-ASTEROID_SPEED, ASTEROID_SPEED)
-                        };
-                    }
-
-                    if (CheckCollisionCircles(player.position, player.size/2,
-                        asteroids[i].position, asteroids[i].size/2)) {
-                        player.health -= 25;  // Asteroid damage
-                        if (player.health <= 0) {
-                            gameOver = true;
-                            crashReason = "You crashed into an asteroid!";
-                        }
-                    }
-                }
-            }
+            // Shots play on pooled voices, placed relative to the player
+            UpdateSoundPool(player->position);
+            GameEvents events = ConsumeGameEvents();
 
-            // Add station collision check
-            for (int i = 0; i < MAX_STATIONS; i++) {
-                if (stations[i].active && 
-                    CheckCollisionCircles(player.position, player.size/2,
-                                        stations[i].position, stations[i].size/2)) {
-                    gameOver = true;
-                    crashReason = "You crashed into a space station, dummy!";
-                }
+            // Captured once the events are taken, so going back to a frame
+            // does not play its shots and explosions a second time
+            if (canRewind && ticks > 0) {
+                CaptureSnapshot(&rewindFrames[rewindHead]);
+                rewindHead = (rewindHead + 1) % REWIND_FRAMES;
+                if (rewindCount < REWIND_FRAMES) rewindCount++;
             }
-
-            // Update AI
-            UpdateAI(player.position, deltaTime, &gameOver);
-
-            // Add AI beam update
-            UpdateAIBeams(player.position, deltaTime);
-
-            // Add player-AI collision check
-            for (int i = 0; i < MAX_AI_SHIPS; i++) {
-                if (CheckCollisionCircles(player.position, player.size/2,
-                    GetAIShipPosition(i), AI_SHIP_SIZE/2)) {
-                    player.health -= AI_COLLISION_DAMAGE;
-                    if (player.health <= 0) {
-                        gameOver = true;
-                        crashReason = "You crashed into an enemy ship!";
-                    }
-                }
+            for (int p = 0; p < MAX_PLAYERS; p++) {
+                if (!(events.playerShooters & (1u << p))) continue;
+                PlaySoundAt(laserSound, GetPlayer(p)->position, LASER_VOLUME,
+                    p == localPlayer ? SOUND_PRIORITY_HIGH : SOUND_PRIORITY_NORMAL);
             }
-
-            // Add AI beam collision with player
-            for (int i = 0; i < MAX_AI_BEAMS; i++) {
-                if (IsAIBeamActive(i) && CheckCollisionCircles(
-                    player.position, player.size/2,
-                    GetAIBeamPosition(i), AI_BEAM_SIZE/2)) {
-                    player.health -= AI_BEAM_DAMAGE;
-                    if (player.health <= 0) {
-                        gameOver = true;
-                        crashReason = "Destroyed by enemy fire!";
-                    }
-                }
+            for (int s = 0; s < events.shotCount; s++) {
+                PlaySoundAt(laserSound, events.shots[s], AI_LASER_VOLUME, SOUND_PRIORITY_NORMAL);
             }
 
-            // Add player beam collision with AI ships (in the beam update loop)
-            for (int i = 0; i < MAX_BEAMS; i++) {
-                if (beams[i].active) {
-                    for (int j = 0; j < MAX_AI_SHIPS; j++) {
-                        if (CheckCollisionCircles(GetAIShipPosition(j), AI_SHIP_SIZE/2,
-                            beams[i].position, BEAM_SIZE/2)) {
-                            DamageAIShip(j, 20);  // Player beam damage
-                            beams[i].active = false;
-                            score += 2;  // Bonus points for hitting enemy ships
-                            break;
-                        }
-                    }
-                }
-            }
+            // Particles are only for show and run on frame time
+            BeginProfileZone(PROFILE_PARTICLES);
+            EmitEffectParticles(&events);
+            if (isMoving) EmitJetParticles(player, frameTime);
+            UpdateParticles(frameTime);
+            EndProfileZone(PROFILE_PARTICLES);
         }
 
+        // Blend factor between the previous and current simulation state
+        float alpha = simAccumulator / SIM_DT;
+        Vector2 renderPlayerPos = Vector2Lerp(player->prevPosition, player->position, alpha);
+        camera.target = renderPlayerPos;
+
+        // World space rectangle covered by the camera
+        Rectangle view = {
+            camera.target.x - camera.offset.x / camera.zoom,
+            camera.target.y - camera.offset.y / camera.zoom,
+            WINDOW_WIDTH / camera.zoom,
+            WINDOW_HEIGHT / camera.zoom
+        };
+        int drawnCount = 0;
+
         BeginDrawing();
         ClearBackground(BLACK);
 
+        // Stars are drawn in screen space, under the camera
+        if (!IsGameOver()) {
+            BeginProfileZone(PROFILE_DRAW_BACKGROUND);
+            DrawStarfield(camera.target);
+            EndProfileZone(PROFILE_DRAW_BACKGROUND);
+        }
+
         BeginMode2D(camera);
 
-        if (!gameOver) {
-            // Draw background with tiling
-            float bgX = -((int)camera.target.x % backgroundTexture.width);
-            float bgY = -((int)camera.target.y % backgroundTexture.height);
-            
-            for (int x = -1; x < 2; x++) {
-                for (int y = -1; y < 2; y++) {
-                    DrawTexture(backgroundTexture, 
-                        bgX + x * backgroundTexture.width + camera.target.x - WINDOW_WIDTH/2, 
-                        bgY + y * backgroundTexture.height + camera.target.y - WINDOW_HEIGHT/2, 
-                        WHITE);
-                }
-            }
+        if (!IsGameOver()) {
+            // Everything else goes through the atlas in one batch
+            BeginSpriteBatch();
+
+            // Particles stream out first and end up under every sprite
+            BeginProfileZone(PROFILE_DRAW_PARTICLES);
+            DrawParticles(view);
+            EndProfileZone(PROFILE_DRAW_PARTICLES);
 
             // Draw player with jet effect
+            BeginProfileZone(PROFILE_DRAW_PLAYER);
             if (isMoving) {
                 // Calculate jet position based on player's direction
-                Vector2 jetPos = player.position;
-                float jetRotation = player.rotation;
+                Vector2 jetPos = renderPlayerPos;
+                float jetRotation = player->rotation;
                 
                 // Move jet effect to back of ship based on rotation (180 degrees opposite)
-                float offsetDistance = player.size * 0.75f;
+                float offsetDistance = player->size * 0.75f;
                 jetPos.x += cosf((jetRotation + 90) * DEG2RAD) * offsetDistance;
                 jetPos.y += sinf((jetRotation + 90) * DEG2RAD) * offsetDistance;
 
                 // Draw jet with fade based on engine volume
-                Rectangle jetSource = (Rectangle){ 0, 0, jetEffect.width, jetEffect.height };
-                Rectangle jetDest = (Rectangle){ 
-                    jetPos.x - player.size/2, 
-                    jetPos.y - player.size/2,
-                    player.size, 
-                    player.size 
-                };
                 Color jetColor = (Color){ 255, 255, 255, (unsigned char)(engineVolume * 255) };
-                DrawTexturePro(jetEffect, jetSource, jetDest, 
-                    (Vector2){ player.size/2, player.size/2 }, 
-                    jetRotation, jetColor);
+                DrawSprite(textureSprites[TEXTURE_JET], SPRITE_LAYER_PLAYER, jetPos,
+                    (Vector2){ player->size, player->size }, jetRotation, jetColor);
             }
 
             // Draw player
-            Rectangle playerSource = (Rectangle){ 0, 0, player.texture.width, player.texture.height };
-            Rectangle playerDest = (Rectangle){ 
-                player.position.x - player.size/2, 
-                player.position.y - player.size/2,
-                player.size, 
-                player.size 
-            };
-            DrawTexturePro(player.texture, playerSource, playerDest, 
-                (Vector2){ player.size/2, player.size/2 }, 
-                player.rotation, WHITE);
-
-            // Draw coins
-            for (int i = 0; i < MAX_COINS; i++) {
-                if (coins[i].active) {
-                    Rectangle coinSource = (Rectangle){ 0, 0, goldTexture.width, goldTexture.height };
-                    Rectangle coinDest = (Rectangle){ 
-                        coins[i].position.x - COIN_SIZE/2, 
-                        coins[i].position.y - COIN_SIZE/2,
-                        COIN_SIZE, 
-                        COIN_SIZE 
-                    };
-                    DrawTexturePro(coins[i].texture, coinSource, coinDest, (Vector2){0, 0}, 0, WHITE);
-                }
+            if (player->alive) {
+                DrawSprite(textureSprites[TEXTURE_SHIP], SPRITE_LAYER_PLAYER, renderPlayerPos,
+                    (Vector2){ player->size, player->size }, player->rotation, WHITE);
             }
+            for (int p = 0; p < MAX_PLAYERS; p++) {
+                if (p != localPlayer && DrawOtherPlayer(GetPlayer(p), alpha, view)) drawnCount++;
+            }
+            EndProfileZone(PROFILE_DRAW_PLAYER);
+
+            // Only entities the broad phase finds near the view are drawn
+            BeginProfileZone(PROFILE_DRAW_COINS);
+            int count = QueryVisibleEntities(CULL_COINS, view, visibleIds, MAX_VISIBLE_IDS);
+            for (int v = 0; v < count; v++) {
+                int i = visibleIds[v];
+                Vector2 coinPos = {
+                    Lerp(coins->prevX[i], coins->posX[i], alpha),
+                    Lerp(coins->prevY[i], coins->posY[i], alpha)
+                };
+                if (!IsSpriteVisible(view, coinPos, COIN_SIZE)) continue;
+                DrawSprite(textureSprites[coins->texture], SPRITE_LAYER_COINS, coinPos,
+                    (Vector2){ COIN_SIZE, COIN_SIZE }, 0, WHITE);
+                drawnCount++;
+            }
+            EndProfileZone(PROFILE_DRAW_COINS);
 
             // Draw asteroids
-            for (int i = 0; i < MAX_ASTEROIDS; i++) {
-                if (asteroids[i].active) {
-                    Rectangle sourceRec = (Rectangle){ 0, 0, asteroidTexture.width, asteroidTexture.height };
-                    Rectangle destRec = (Rectangle){ 
-                        asteroids[i].position.x - asteroids[i].size/2, 
-                        asteroids[i].position.y - asteroids[i].size/2,
-                        asteroids[i].size, 
-                        asteroids[i].size 
-                    };
-                    DrawTexturePro(asteroids[i].texture, sourceRec, destRec, (Vector2){0, 0}, 0, WHITE);
-                }
+            BeginProfileZone(PROFILE_DRAW_ASTEROIDS);
+            count = QueryVisibleEntities(CULL_ASTEROIDS, view, visibleIds, MAX_VISIBLE_IDS);
+            for (int v = 0; v < count; v++) {
+                int i = visibleIds[v];
+                Vector2 asteroidPos = {
+                    Lerp(asteroids->prevX[i], asteroids->posX[i], alpha),
+                    Lerp(asteroids->prevY[i], asteroids->posY[i], alpha)
+                };
+                if (!IsSpriteVisible(view, asteroidPos, asteroids->size[i])) continue;
+                DrawSprite(textureSprites[asteroids->texture], SPRITE_LAYER_ASTEROIDS, asteroidPos,
+                    (Vector2){ asteroids->size[i], asteroids->size[i] }, 0, WHITE);
+                drawnCount++;
             }
-
-            // Draw beams with correct direction
-            for (int i = 0; i < MAX_BEAMS; i++) {
-                if (beams[i].active) {
-                    Rectangle beamSource = (Rectangle){ 0, 0, beamEffect.width, beamEffect.height };
-                    Rectangle beamDest = (Rectangle){ 
-                        beams[i].position.x - 8, 
-                        beams[i].position.y - 4,
-                        16, 
-                        8 
-                    };
-                    // Calculate beam rotation based on velocity
-                    float beamRotation = atan2f(beams[i].velocity.y, beams[i].velocity.x) * RAD2DEG;
-                    DrawTexturePro(beamEffect, beamSource, beamDest, 
-                        (Vector2){ 8, 4 }, beamRotation, WHITE);
-                }
+            EndProfileZone(PROFILE_DRAW_ASTEROIDS);
+
+            // Draw beams with correct direction, they are few and short lived
+            BeginProfileZone(PROFILE_DRAW_BEAMS);
+            for (int i = 0; i < beams->pool.count; i++) {
+                Vector2 beamPos = {
+                    Lerp(beams->prevX[i], beams->posX[i], alpha),
+                    Lerp(beams->prevY[i], beams->posY[i], alpha)
+                };
+                if (!IsSpriteVisible(view, beamPos, 16)) continue;
+                // Calculate beam rotation based on velocity
+                float beamRotation = atan2f(beams->velY[i], beams->velX[i]) * RAD2DEG;
+                DrawSprite(textureSprites[beams->texture], SPRITE_LAYER_BEAMS, beamPos,
+                    (Vector2){ 16, 8 }, beamRotation, WHITE);
+                drawnCount++;
             }
+            EndProfileZone(PROFILE_DRAW_BEAMS);
 
             // Draw stations
-            for (int i = 0; i < MAX_STATIONS; i++) {
-                if (stations[i].active) {
-                    Rectangle sourceRec = (Rectangle){ 0, 0, stationTexture.width, stationTexture.height };
-                    Rectangle destRec = (Rectangle){ 
-                        stations[i].position.x - stations[i].size/2, 
-                        stations[i].position.y - stations[i].size/2,
-                        stations[i].size, 
-                        stations[i].size 
-                    };
-                    DrawTexturePro(stations[i].texture, sourceRec, destRec, (Vector2){0, 0}, 0, WHITE);
-                }
+            BeginProfileZone(PROFILE_DRAW_STATIONS);
+            count = QueryVisibleEntities(CULL_STATIONS, view, visibleIds, MAX_VISIBLE_IDS);
+            for (int v = 0; v < count; v++) {
+                const Station* station = &stations[visibleIds[v]];
+                if (!IsSpriteVisible(view, station->position, station->size)) continue;
+                DrawSprite(textureSprites[station->texture], SPRITE_LAYER_STATIONS,
+                    station->position, (Vector2){ station->size, station->size },
+                    0, WHITE);
+                drawnCount++;
             }
+            EndProfileZone(PROFILE_DRAW_STATIONS);
 
             // Draw AI ships
-            DrawAIShips();
+            BeginProfileZone(PROFILE_DRAW_AI);
+            count = QueryVisibleEntities(CULL_AI_SHIPS, view, visibleIds, MAX_VISIBLE_IDS);
+            for (int v = 0; v < count; v++) {
+                if (DrawAIShip(visibleIds[v], alpha, view)) drawnCount++;
+            }
 
             // Draw AI beams
-            DrawAIBeams();
+            drawnCount += DrawAIBeams(alpha, view);
+            EndProfileZone(PROFILE_DRAW_AI);
+
+            // Sprites only reach the GPU here, the sections above just queue them
+            BeginProfileZone(PROFILE_DRAW_FLUSH);
+            EndSpriteBatch();
+            EndProfileZone(PROFILE_DRAW_FLUSH);
         }
 
         EndMode2D();
 
         // Draw HUD elements
-        if (!gameOver) {
+        BeginProfileZone(PROFILE_DRAW_HUD);
+        if (!IsGameOver()) {
             // Health bar
             DrawRectangle(
                 WINDOW_WIDTH - HEALTH_BAR_WIDTH - HUD_MARGIN,
@@ -609,18 +652,32 @@ int main(void) {
             DrawRectangle(
                 WINDOW_WIDTH - HEALTH_BAR_WIDTH - HUD_MARGIN,
                 HUD_MARGIN,
-                (HEALTH_BAR_WIDTH * player.health) / PLAYER_MAX_HEALTH,
+                (HEALTH_BAR_WIDTH * fmaxf(player->health, 0)) / PLAYER_MAX_HEALTH,
                 HEALTH_BAR_HEIGHT,
                 GREEN
             );
 
             // Score HUD
             DrawRectangle(HUD_MARGIN, HUD_MARGIN, 100, 25, Fade(BLACK, 0.5f));
-            DrawText(TextFormat("SCORE: %d", score), 
+            DrawText(TextFormat("SCORE: %d", GetScore()), 
                 HUD_MARGIN + 5, 
                 HUD_MARGIN + 5, 
                 HUD_TEXT_SIZE, 
                 WHITE);
+
+            if (replayMode == REPLAY_MODE_PLAY) {
+                DrawText(replayEnded ? "REPLAY FINISHED" : "REPLAY",
+                    HUD_MARGIN, HUD_MARGIN + 30, HUD_TEXT_SIZE, YELLOW);
+            } else if (replayMode == REPLAY_MODE_RECORD) {
+                DrawText("REC", HUD_MARGIN, HUD_MARGIN + 30, HUD_TEXT_SIZE, RED);
+            } else if (rewinding) {
+                DrawText("REWIND", HUD_MARGIN, HUD_MARGIN + 30, HUD_TEXT_SIZE, YELLOW);
+            } else if (netPort != 0) {
+                NetClientStats net = GetNetClientStats();
+                const char* status = !net.connected ? (net.snapshots > 0 ? "CONNECTION LOST" : "CONNECTING") :
+                                     player->alive ? "ONLINE" : "CRASHED, WAIT FOR THE NEXT GAME";
+                DrawText(status, HUD_MARGIN, HUD_MARGIN + 30, HUD_TEXT_SIZE, net.connected ? GREEN : YELLOW);
+            }
         } else {
             // Game Over HUD
             int hudWidth = 300;
@@ -633,8 +690,8 @@ int main(void) {
 
             // Draw game over text
             const char* gameOverText = "GAME OVER";
-            const char* crashMessage = crashReason ? crashReason : "You crashed!";
-            const char* scoreText = TextFormat("Final Score: %d", score);
+            const char* crashMessage = GetCrashReason(localPlayer) ? GetCrashReason(localPlayer) : "You crashed!";
+            const char* scoreText = TextFormat("Final Score: %d", GetScore());
             const char* restartText = "Press ENTER to restart";
 
             int gameOverWidth = MeasureText(gameOverText, 40);
@@ -681,24 +738,71 @@ int main(void) {
 
         #ifdef _DEBUG
             DrawFPS(WINDOW_WIDTH - 80, WINDOW_HEIGHT - 20);
+            DrawText(IsSpatialHashEnabled() ? "Broad phase: grid" : "Broad phase: brute force",
+                HUD_MARGIN, WINDOW_HEIGHT - 20, 10, GRAY);
+            DrawText(TextFormat("Projectile kernel: %s", GetProjectileKernelName()),
+                HUD_MARGIN, WINDOW_HEIGHT - 32, 10, GRAY);
+            DrawText(TextFormat("Sprites: %d in %d batches",
+                GetSpriteBatchSpriteCount(), GetSpriteBatchFlushCount()),
+                HUD_MARGIN, WINDOW_HEIGHT - 44, 10, GRAY);
+            int activeStations = 0;
+            for (int i = 0; i < MAX_STATIONS; i++) {
+                if (stations[i].active) activeStations++;
+            }
+            int entityCount = coins->count + asteroids->count + beams->pool.count +
+                              activeStations + GetAIShipCount() + GetAIBeamCount();
+            DrawText(TextFormat("Culling: %d drawn, %d culled", drawnCount, entityCount - drawnCount),
+                HUD_MARGIN, WINDOW_HEIGHT - 56, 10, GRAY);
+            AILodStats lod = GetAILodStats();
+            DrawText(TextFormat("AI LOD: near %d/%d, mid %d/%d, far %d/%d updated",
+                lod.updated[AI_LOD_NEAR], lod.ships[AI_LOD_NEAR],
+                lod.updated[AI_LOD_MID], lod.ships[AI_LOD_MID],
+                lod.updated[AI_LOD_FAR], lod.ships[AI_LOD_FAR]),
+                HUD_MARGIN, WINDOW_HEIGHT - 68, 10, GRAY);
+            DrawText(TextFormat("Particles: %d, %d drawn", GetParticleCount(), GetParticleDrawCount()),
+                HUD_MARGIN, WINDOW_HEIGHT - 80, 10, GRAY);
+            DrawText(TextFormat("Sound voices: %d/%d", GetSoundVoiceCount(), MAX_SOUND_VOICES),
+                HUD_MARGIN, WINDOW_HEIGHT - 92, 10, GRAY);
+            if (netPort != 0) {
+                NetClientStats net = GetNetClientStats();
+                DrawText(TextFormat("Net: tick %u, %d bytes, %d predicted, %.1f correction, %lld dropped",
+                    net.sequence, net.snapshotBytes, net.predictedTicks, net.correction, net.dropped),
+                    HUD_MARGIN, WINDOW_HEIGHT - 104, 10, GRAY);
+            }
         #endif
+        EndProfileZone(PROFILE_DRAW_HUD);
+
+        if (profilerVisible) DrawProfilerOverlay();
 
         EndDrawing();
+        EndProfileFrame();
+    }
+
+    EndProfileCapture();
+
+    if (replayMode == REPLAY_MODE_RECORD) {
+        if (SaveReplay(&replay, replayPath)) {
+            TraceLog(LOG_INFO, "REPLAY: Saved %lld ticks to %s", replay.info.ticks, replayPath);
+        } else {
+            TraceLog(LOG_WARNING, "REPLAY: Could not save %s", replayPath);
+        }
+    }
+    UnloadReplay(&replay);
+    if (netPort != 0) DisconnectNetClient();
+    for (int f = 0; f < REWIND_FRAMES; f++) {
+        UnloadSnapshot(&rewindFrames[f]);
     }
 
     // Unload resources
-    UnloadTexture(backgroundTexture);
-    UnloadTexture(shipTexture);
-    UnloadTexture(goldTexture);
-    UnloadTexture(asteroidTexture);
-    UnloadTexture(jetEffect);
-    UnloadTexture(beamEffect);
-    UnloadTexture(stationTexture);
-    UnloadSound(engineSound);
-    UnloadSound(engineBoostSound);
-    UnloadSound(laserSound);
+    UnloadSpriteAtlas();
+    UnloadStarfield();
+    UnloadSoundPool();
+    ReleaseAsset(engineAsset);
+    ReleaseAsset(engineBoostAsset);
+    ReleaseAsset(laserAsset);
+    UnloadAssets();
     CloseAudioDevice();
     CloseWindow();
-    UnloadAI();
+    UnloadGame();
     return 0;
 } 
\ No newline at end of file
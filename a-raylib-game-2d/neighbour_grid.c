@@ -0,0 +1,96 @@
+#include "neighbour_grid.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static int CellCoord(const NeighbourGrid* grid, float value) {
+    return (int)floorf(value / grid->cellSize);
+}
+
+static int HashCell(int cellX, int cellY) {
+    unsigned int h = ((unsigned int)cellX * 73856093u) ^ ((unsigned int)cellY * 19349663u);
+    return (int)(h & (NEIGHBOUR_GRID_BUCKETS - 1));
+}
+
+void InitNeighbourGrid(NeighbourGrid* grid, float cellSize, int capacity) {
+    grid->cellSize = cellSize;
+    grid->count = 0;
+    grid->capacity = capacity;
+    grid->cellStart = calloc(NEIGHBOUR_GRID_BUCKETS + 1, sizeof(int));
+    grid->ids = malloc(sizeof(int) * capacity);
+    grid->x = malloc(sizeof(float) * capacity);
+    grid->y = malloc(sizeof(float) * capacity);
+    grid->bucket = malloc(sizeof(int) * capacity);
+}
+
+void UnloadNeighbourGrid(NeighbourGrid* grid) {
+    free(grid->cellStart);
+    free(grid->ids);
+    free(grid->x);
+    free(grid->y);
+    free(grid->bucket);
+    *grid = (NeighbourGrid){ 0 };
+}
+
+void BuildNeighbourGrid(NeighbourGrid* grid, const float* x, const float* y, int count) {
+    if (count > grid->capacity) count = grid->capacity;
+    grid->count = count;
+
+    // Count points per bucket, then turn the counts into run starts
+    int* cellStart = grid->cellStart;
+    memset(cellStart, 0, sizeof(int) * (NEIGHBOUR_GRID_BUCKETS + 1));
+    for (int i = 0; i < count; i++) {
+        grid->bucket[i] = HashCell(CellCoord(grid, x[i]), CellCoord(grid, y[i]));
+        cellStart[grid->bucket[i] + 1]++;
+    }
+    for (int b = 0; b < NEIGHBOUR_GRID_BUCKETS; b++) {
+        cellStart[b + 1] += cellStart[b];
+    }
+
+    // Scatter, using cellStart as the write cursor and shifting it back after
+    for (int i = 0; i < count; i++) {
+        int slot = cellStart[grid->bucket[i]]++;
+        grid->ids[slot] = i;
+        grid->x[slot] = x[i];
+        grid->y[slot] = y[i];
+    }
+    memmove(cellStart + 1, cellStart, sizeof(int) * NEIGHBOUR_GRID_BUCKETS);
+    cellStart[0] = 0;
+}
+
+int QueryNeighbourGrid(const NeighbourGrid* grid, Vector2 center, float radius, int* slots, int maxSlots) {
+    int minX = CellCoord(grid, center.x - radius);
+    int maxX = CellCoord(grid, center.x + radius);
+    int minY = CellCoord(grid, center.y - radius);
+    int maxY = CellCoord(grid, center.y + radius);
+    float radiusSqr = radius * radius;
+    int found = 0;
+
+    // Cells sharing a bucket are told apart by distance alone, so each
+    // bucket may only be walked once per query
+    int visited[9];
+    int visitedCount = 0;
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            int bucket = HashCell(cx, cy);
+            bool seen = false;
+            for (int v = 0; v < visitedCount; v++) {
+                if (visited[v] == bucket) seen = true;
+            }
+            if (seen) continue;
+            if (visitedCount < 9) visited[visitedCount++] = bucket;
+
+            for (int s = grid->cellStart[bucket]; s < grid->cellStart[bucket + 1]; s++) {
+                float dx = grid->x[s] - center.x;
+                float dy = grid->y[s] - center.y;
+                if (dx*dx + dy*dy > radiusSqr) continue;
+
+                slots[found++] = s;
+                if (found >= maxSlots) return found;
+            }
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,32 @@
+#ifndef NEIGHBOUR_GRID_H
+#define NEIGHBOUR_GRID_H
+
+#include "raylib.h"
+
+// Broad phase for many points that all move every tick. Points are
+// counting sorted by cell into flat arrays, so every cell is one contiguous
+// run and a query walks memory in order instead of chasing bucket chains.
+// Positions are copied in, the grid does not change until it is rebuilt.
+#define NEIGHBOUR_GRID_BUCKETS 8192  // Must be a power of two
+
+typedef struct {
+    float cellSize;
+    int count;
+    int capacity;
+    int* cellStart;  // Bucket -> first slot, NEIGHBOUR_GRID_BUCKETS + 1 entries
+    int* ids;        // Slot -> point id, slots are in cell order
+    float* x;        // Slot -> position
+    float* y;
+    int* bucket;     // Slot -> scratch bucket while building
+} NeighbourGrid;
+
+void InitNeighbourGrid(NeighbourGrid* grid, float cellSize, int capacity);
+void UnloadNeighbourGrid(NeighbourGrid* grid);
+// Sorts points [0, count) into cells, point ids are their indices
+void BuildNeighbourGrid(NeighbourGrid* grid, const float* x, const float* y, int count);
+// Writes the slots of points within radius of center, radius may not be
+// larger than the cell size. Walking slots in order instead of ids visits
+// points cell by cell.
+int QueryNeighbourGrid(const NeighbourGrid* grid, Vector2 center, float radius, int* slots, int maxSlots);
+
+#endif // NEIGHBOUR_GRID_H
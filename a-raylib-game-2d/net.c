@@ -0,0 +1,166 @@
+#include "net.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+int OpenNetSocket(int port) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return -1;
+
+    // Fragments of a whole snapshot can arrive in one burst
+    int bufferSize = NET_FRAGMENT_SIZE * NET_MAX_FRAGMENTS;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    NetAddress address = GetLoopbackAddress(port);
+    if (bind(sock, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void CloseNetSocket(int socket) {
+    if (socket >= 0) close(socket);
+}
+
+NetAddress GetLoopbackAddress(int port) {
+    NetAddress address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+int GetNetSocketPort(int socket) {
+    NetAddress address;
+    socklen_t length = sizeof(address);
+    if (getsockname(socket, (struct sockaddr*)&address, &length) != 0) return -1;
+    return ntohs(address.sin_port);
+}
+
+bool SameNetAddress(const NetAddress* a, const NetAddress* b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+bool SendNetPacket(int socket, const NetAddress* to, const void* data, size_t size) {
+    return sendto(socket, data, size, 0, (const struct sockaddr*)to, sizeof(*to)) == (ssize_t)size;
+}
+
+int ReceiveNetPacket(int socket, NetAddress* from, void* buffer, size_t capacity) {
+    socklen_t length = sizeof(*from);
+    ssize_t size = recvfrom(socket, buffer, capacity, 0, (struct sockaddr*)from, &length);
+    return size < 0 ? -1 : (int)size;
+}
+
+size_t SendNetSnapshot(int socket, const NetAddress* to, NetSnapshotHeader header,
+                       const unsigned char* encoded) {
+    unsigned char packet[sizeof(NetSnapshotHeader) + NET_FRAGMENT_SIZE];
+    header.type = NET_PACKET_SNAPSHOT;
+    header.fragmentCount = (uint16_t)((header.encodedSize + NET_FRAGMENT_SIZE - 1) / NET_FRAGMENT_SIZE);
+    if (header.fragmentCount == 0) header.fragmentCount = 1;
+    if (header.fragmentCount > NET_MAX_FRAGMENTS) return 0;
+
+    size_t sent = 0;
+    for (int f = 0; f < header.fragmentCount; f++) {
+        size_t offset = (size_t)f * NET_FRAGMENT_SIZE;
+        size_t size = header.encodedSize - offset < NET_FRAGMENT_SIZE ? header.encodedSize - offset : NET_FRAGMENT_SIZE;
+        header.fragment = (uint16_t)f;
+        memcpy(packet, &header, sizeof(header));
+        memcpy(packet + sizeof(header), encoded + offset, size);
+        if (SendNetPacket(socket, to, packet, sizeof(header) + size)) sent += sizeof(header) + size;
+    }
+    return sent;
+}
+
+// LEB128 like the replay stream, run lengths are mostly a byte or two
+static size_t PutVarint(unsigned char* out, size_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+static bool GetVarint(const unsigned char* in, size_t size, size_t* cursor, size_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *cursor < size; shift += 7) {
+        unsigned char byte = in[(*cursor)++];
+        *value |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline unsigned char BaselineByte(const unsigned char* baseline, size_t i) {
+    return baseline != NULL ? baseline[i] : 0;
+}
+
+// Skips bytes that match the baseline, eight at a time where it can
+static size_t SkipMatching(const unsigned char* state, const unsigned char* baseline, size_t i, size_t size) {
+    static const unsigned char zeros[8] = { 0 };
+    while (i + 8 <= size && memcmp(state + i, baseline != NULL ? baseline + i : zeros, 8) == 0) i += 8;
+    while (i < size && state[i] == BaselineByte(baseline, i)) i++;
+    return i;
+}
+
+size_t GetSnapshotDeltaBound(size_t size) {
+    // A run pair covers at least NET_DELTA_MIN_MATCH + 1 bytes and costs at
+    // most two varints on top of its new bytes
+    return size + (size / (NET_DELTA_MIN_MATCH + 1) + 1) * 2 * 10;
+}
+
+size_t EncodeSnapshotDelta(const unsigned char* state, const unsigned char* baseline, size_t size,
+                           unsigned char* out) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size) {
+        size_t copyStart = i;
+        i = SkipMatching(state, baseline, i, size);
+        size_t copyCount = i - copyStart;
+
+        // New bytes run until enough matching ones come in a row
+        size_t literalStart = i;
+        size_t matching = 0;
+        while (i < size && matching < NET_DELTA_MIN_MATCH) {
+            matching = state[i] == BaselineByte(baseline, i) ? matching + 1 : 0;
+            i++;
+        }
+        if (matching == NET_DELTA_MIN_MATCH) i -= matching;
+        size_t literalCount = i - literalStart;
+
+        o += PutVarint(out + o, copyCount);
+        o += PutVarint(out + o, literalCount);
+        memcpy(out + o, state + literalStart, literalCount);
+        o += literalCount;
+    }
+    return o;
+}
+
+bool DecodeSnapshotDelta(const unsigned char* encoded, size_t encodedSize,
+                         const unsigned char* baseline, unsigned char* state, size_t size) {
+    size_t cursor = 0;
+    size_t i = 0;
+    while (cursor < encodedSize) {
+        size_t copyCount;
+        size_t literalCount;
+        if (!GetVarint(encoded, encodedSize, &cursor, &copyCount) ||
+            !GetVarint(encoded, encodedSize, &cursor, &literalCount)) return false;
+        if (copyCount > size - i || literalCount > size - i - copyCount ||
+            literalCount > encodedSize - cursor) return false;
+
+        if (baseline != NULL) memcpy(state + i, baseline + i, copyCount);
+        else memset(state + i, 0, copyCount);
+        i += copyCount;
+
+        memcpy(state + i, encoded + cursor, literalCount);
+        i += literalCount;
+        cursor += literalCount;
+    }
+    return i == size;
+}
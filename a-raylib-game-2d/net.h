@@ -0,0 +1,85 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include "game_defs.h"
+
+// UDP protocol between the headless server and game clients. The server
+// owns the simulation and sends every client a snapshot each tick, encoded
+// against the last snapshot that client acknowledged so only the bytes that
+// changed travel. Clients send their input every tick, repeating the last
+// few inputs in each packet so a lost packet costs nothing.
+//
+// Snapshots are raw simulation memory (see snapshot.h), so server and
+// clients must be the same build. Packets are never routed off the machine.
+
+#define NET_DEFAULT_PORT 27960
+#define NET_MAX_CLIENTS MAX_PLAYERS  // Client c flies player c
+#define NET_FRAGMENT_SIZE 1200          // Snapshot bytes per datagram
+#define NET_MAX_FRAGMENTS 512
+#define NET_SNAPSHOT_HISTORY 32         // Snapshots kept as delta baselines, on both sides
+#define NET_INPUT_HISTORY 64            // Inputs a client may be ahead of the server
+#define NET_INPUT_REDUNDANCY 8          // Inputs repeated in every input packet
+#define NET_TIMEOUT_TICKS (SIM_TICK_RATE * 5)
+#define NET_DELTA_MIN_MATCH 4           // Unchanged bytes that end a literal run
+
+typedef enum {
+    NET_PACKET_CONNECT = 1,
+    NET_PACKET_INPUT,       // Also the keepalive and the snapshot ack
+    NET_PACKET_DISCONNECT,
+    NET_PACKET_SNAPSHOT     // One fragment of an encoded snapshot
+} NetPacketType;
+
+// inputs[i] is the input of tick lastInput - inputCount + 1 + i
+typedef struct {
+    uint8_t type;
+    uint8_t restart;     // Start a new game if the current one is over
+    uint16_t inputCount;
+    uint32_t ack;        // Newest snapshot the client has, 0 for none
+    uint32_t lastInput;  // Sequence number of the newest input
+    uint8_t inputs[NET_INPUT_REDUNDANCY];
+} NetInputPacket;
+
+typedef struct {
+    uint8_t type;
+    uint8_t player;         // Ship of the receiving client
+    uint16_t fragment;
+    uint16_t fragmentCount;
+    uint16_t reserved;
+    uint32_t sequence;      // Server tick the snapshot was taken after
+    uint32_t baseline;      // Snapshot the delta is against, 0 for none
+    uint32_t lastInput;     // Newest input of the receiving client in the state
+    uint32_t stateSize;     // Decoded size
+    uint32_t encodedSize;
+} NetSnapshotHeader;
+
+typedef struct sockaddr_in NetAddress;
+
+// Non-blocking UDP socket on the loopback interface, port 0 picks one.
+// Returns -1 on failure.
+int OpenNetSocket(int port);
+void CloseNetSocket(int socket);
+NetAddress GetLoopbackAddress(int port);
+int GetNetSocketPort(int socket);
+bool SameNetAddress(const NetAddress* a, const NetAddress* b);
+bool SendNetPacket(int socket, const NetAddress* to, const void* data, size_t size);
+// Returns the packet size, or -1 once nothing is waiting
+int ReceiveNetPacket(int socket, NetAddress* from, void* buffer, size_t capacity);
+
+// Splits an encoded snapshot into fragments, returns the bytes sent
+size_t SendNetSnapshot(int socket, const NetAddress* to, NetSnapshotHeader header,
+                       const unsigned char* encoded);
+
+// Delta coding of snapshots against a baseline of the same size, or against
+// zeros when baseline is NULL. The encoding alternates runs of bytes the
+// baseline already has with runs of new bytes, each run led by its length.
+size_t GetSnapshotDeltaBound(size_t size);
+size_t EncodeSnapshotDelta(const unsigned char* state, const unsigned char* baseline, size_t size,
+                           unsigned char* out);
+bool DecodeSnapshotDelta(const unsigned char* encoded, size_t encodedSize,
+                         const unsigned char* baseline, unsigned char* state, size_t size);
+
+#endif // NET_H
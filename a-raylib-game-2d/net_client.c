@@ -0,0 +1,243 @@
+#include "net_client.h"
+#include "raymath.h"
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "net.h"
+#include "snapshot.h"
+
+// Snapshots kept as baselines for the deltas still on their way
+typedef struct {
+    uint32_t sequence;
+    Snapshot snapshot;
+} ReceivedSnapshot;
+
+// Fragments of the newest snapshot being put back together
+typedef struct {
+    NetSnapshotHeader header;  // sequence 0 while nothing is in progress
+    int received;
+    bool fragments[NET_MAX_FRAGMENTS];
+    unsigned char* data;
+    size_t capacity;
+} SnapshotAssembly;
+
+static int clientSocket = -1;
+static NetAddress serverAddress;
+static int player = -1;             // Ship the server gave this client
+static bool restartRequested = false;
+static uint32_t inputSequence = 0;   // Newest input sampled here
+static uint32_t serverInput = 0;     // Newest input in the applied snapshot
+static unsigned char inputs[NET_INPUT_HISTORY];
+static ReceivedSnapshot received[NET_SNAPSHOT_HISTORY];
+static uint32_t newestSnapshot = 0;  // Also what gets acknowledged
+static SnapshotAssembly assembly = { 0 };
+static int framesSinceSnapshot = 0;
+static NetClientStats stats = { 0 };
+
+bool ConnectNetClient(int port) {
+    DisconnectNetClient();
+    clientSocket = OpenNetSocket(0);
+    if (clientSocket < 0) return false;
+    serverAddress = GetLoopbackAddress(port);
+    return true;
+}
+
+void DisconnectNetClient(void) {
+    if (clientSocket >= 0) {
+        uint8_t type = NET_PACKET_DISCONNECT;
+        SendNetPacket(clientSocket, &serverAddress, &type, sizeof(type));
+        CloseNetSocket(clientSocket);
+    }
+    for (int s = 0; s < NET_SNAPSHOT_HISTORY; s++) {
+        UnloadSnapshot(&received[s].snapshot);
+    }
+    free(assembly.data);
+
+    clientSocket = -1;
+    player = -1;
+    restartRequested = false;
+    inputSequence = 0;
+    serverInput = 0;
+    memset(received, 0, sizeof(received));
+    newestSnapshot = 0;
+    assembly = (SnapshotAssembly){ 0 };
+    framesSinceSnapshot = 0;
+    stats = (NetClientStats){ 0 };
+}
+
+// Acknowledges the newest snapshot and resends every input the server has
+// not used yet, up to NET_INPUT_REDUNDANCY of them
+static void SendInputs(void) {
+    if (newestSnapshot == 0) {
+        uint8_t type = NET_PACKET_CONNECT;
+        SendNetPacket(clientSocket, &serverAddress, &type, sizeof(type));
+        return;
+    }
+
+    NetInputPacket packet = {
+        .type = NET_PACKET_INPUT,
+        .restart = restartRequested,
+        .ack = newestSnapshot
+    };
+    if (player >= 0) {
+        uint32_t pending = inputSequence - serverInput;
+        packet.inputCount = (uint16_t)(pending < NET_INPUT_REDUNDANCY ? pending : NET_INPUT_REDUNDANCY);
+        packet.lastInput = inputSequence;
+        for (int i = 0; i < packet.inputCount; i++) {
+            uint32_t sequence = inputSequence - packet.inputCount + 1 + i;
+            packet.inputs[i] = inputs[sequence % NET_INPUT_HISTORY];
+        }
+    }
+    SendNetPacket(clientSocket, &serverAddress, &packet, sizeof(packet));
+}
+
+// Decodes the assembled snapshot against its baseline, false if the
+// baseline is gone
+static bool DecodeAssembly(void) {
+    const NetSnapshotHeader* header = &assembly.header;
+    const unsigned char* baseline = NULL;
+    if (header->baseline != 0) {
+        const ReceivedSnapshot* base = &received[header->baseline % NET_SNAPSHOT_HISTORY];
+        if (base->sequence != header->baseline || base->snapshot.size != header->stateSize) return false;
+        baseline = base->snapshot.data;
+    }
+
+    ReceivedSnapshot* slot = &received[header->sequence % NET_SNAPSHOT_HISTORY];
+    if (slot->snapshot.capacity < header->stateSize) {
+        unsigned char* data = realloc(slot->snapshot.data, header->stateSize);
+        if (data == NULL) return false;
+        slot->snapshot.data = data;
+        slot->snapshot.capacity = header->stateSize;
+    }
+    slot->sequence = 0;
+    if (!DecodeSnapshotDelta(assembly.data, header->encodedSize, baseline,
+                             slot->snapshot.data, header->stateSize)) return false;
+    slot->snapshot.size = header->stateSize;
+    slot->sequence = header->sequence;
+    return true;
+}
+
+// Returns true when the fragment completes a snapshot newer than the last one
+static bool AddFragment(const NetSnapshotHeader* header, const unsigned char* data, size_t size) {
+    if (header->sequence <= newestSnapshot || header->sequence < assembly.header.sequence) return false;
+
+    if (header->sequence != assembly.header.sequence) {
+        // A newer snapshot started, whatever was missing from the last one is not coming
+        if (assembly.header.sequence != 0) stats.dropped++;
+        if (header->fragmentCount == 0 || header->fragmentCount > NET_MAX_FRAGMENTS ||
+            header->encodedSize > (size_t)header->fragmentCount * NET_FRAGMENT_SIZE) return false;
+        if (assembly.capacity < header->encodedSize) {
+            unsigned char* buffer = realloc(assembly.data, header->encodedSize);
+            if (buffer == NULL) return false;
+            assembly.data = buffer;
+            assembly.capacity = header->encodedSize;
+        }
+        assembly.header = *header;
+        assembly.received = 0;
+        memset(assembly.fragments, 0, sizeof(assembly.fragments));
+    }
+
+    size_t offset = (size_t)header->fragment * NET_FRAGMENT_SIZE;
+    if (header->fragment >= assembly.header.fragmentCount || assembly.fragments[header->fragment] ||
+        offset + size > assembly.header.encodedSize) return false;
+    memcpy(assembly.data + offset, data, size);
+    assembly.fragments[header->fragment] = true;
+    assembly.received++;
+
+    if (assembly.received < assembly.header.fragmentCount) return false;
+    bool decoded = DecodeAssembly();
+    if (!decoded) stats.dropped++;
+    assembly.header.sequence = 0;
+    return decoded;
+}
+
+// Other players are predicted to keep the input they had in the snapshot
+static void PredictTick(unsigned int input) {
+    unsigned int tickInputs[MAX_PLAYERS];
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        tickInputs[p] = GetPlayer(p)->input;
+    }
+    tickInputs[player] = input;
+    SavePreviousState();
+    UpdateGamePlayers(tickInputs, SIM_DT);
+}
+
+void PollNetClient(void) {
+    if (clientSocket < 0) return;
+
+    unsigned char packet[sizeof(NetSnapshotHeader) + NET_FRAGMENT_SIZE];
+    NetAddress from;
+    NetSnapshotHeader newest = { 0 };
+    int size;
+    while ((size = ReceiveNetPacket(clientSocket, &from, packet, sizeof(packet))) >= 0) {
+        if (!SameNetAddress(&from, &serverAddress) || size < (int)sizeof(NetSnapshotHeader)) continue;
+
+        NetSnapshotHeader header;
+        memcpy(&header, packet, sizeof(header));
+        if (header.type != NET_PACKET_SNAPSHOT) continue;
+        if (AddFragment(&header, packet + sizeof(header), size - sizeof(header))) {
+            newestSnapshot = header.sequence;
+            newest = header;
+        }
+    }
+
+    // Only the newest snapshot of the frame is applied, older ones just
+    // stay around as baselines
+    framesSinceSnapshot++;
+    if (newest.sequence != 0) {
+        Vector2 predicted = player >= 0 ? GetPlayer(player)->position : (Vector2){ 0 };
+        if (newest.player < MAX_PLAYERS &&
+            RestoreSnapshot(&received[newest.sequence % NET_SNAPSHOT_HISTORY].snapshot)) {
+            bool sameShip = player == newest.player;
+            framesSinceSnapshot = 0;
+            player = newest.player;
+            serverInput = newest.lastInput;
+            if (!IsGameOver()) restartRequested = false;
+
+            // The server's events were already shown when these ticks were
+            // predicted, and so are those of the ticks run again
+            ConsumeGameEvents();
+            int predictedTicks = 0;
+            if (inputSequence < serverInput) inputSequence = serverInput;
+            for (uint32_t s = serverInput + 1; s <= inputSequence && !IsGameOver(); s++) {
+                PredictTick(inputs[s % NET_INPUT_HISTORY]);
+                predictedTicks++;
+            }
+            ConsumeGameEvents();
+
+            stats.sequence = newest.sequence;
+            stats.predictedTicks = predictedTicks;
+            stats.snapshotBytes = (int)newest.encodedSize;
+            stats.correction = sameShip ? Vector2Distance(predicted, GetPlayer(player)->position) : 0.0f;
+            stats.snapshots++;
+        } else {
+            stats.dropped++;
+        }
+    }
+    stats.connected = stats.snapshots > 0 && framesSinceSnapshot < NET_TIMEOUT_TICKS;
+    stats.player = player;
+
+    SendInputs();
+}
+
+void TickNetClient(unsigned int input) {
+    // Stop predicting once the server falls too far behind to catch up
+    if (clientSocket < 0 || player < 0 || inputSequence - serverInput >= NET_INPUT_HISTORY - 1) return;
+
+    inputSequence++;
+    inputs[inputSequence % NET_INPUT_HISTORY] = (unsigned char)input;
+    PredictTick(input);
+    SendInputs();
+}
+
+void RequestNetRestart(void) {
+    restartRequested = true;
+}
+
+int GetNetClientPlayer(void) {
+    return player;
+}
+
+NetClientStats GetNetClientStats(void) {
+    return stats;
+}
@@ -0,0 +1,35 @@
+#ifndef NET_CLIENT_H
+#define NET_CLIENT_H
+
+#include <stdbool.h>
+
+// Client side of the multiplayer protocol in net.h. Snapshots from the
+// server replace the local simulation as they arrive. The client keeps
+// ticking the simulation itself, and every input the server has not used
+// yet is run again on top of each snapshot, so its ship answers at once
+// instead of a round trip later. The other ships keep their last input.
+
+typedef struct {
+    bool connected;          // A snapshot arrived in the last few seconds
+    int player;              // Ship of this client, -1 before the first snapshot
+    unsigned int sequence;   // Server tick of the newest snapshot
+    int predictedTicks;      // Inputs run on top of it
+    int snapshotBytes;       // Encoded size of the newest snapshot
+    float correction;        // How far the ship moved when the newest snapshot was applied
+    long long snapshots;     // Snapshots applied
+    long long dropped;       // Snapshots that could not be put together
+} NetClientStats;
+
+bool ConnectNetClient(int port);
+void DisconnectNetClient(void);
+// Applies the newest snapshot and acknowledges it, call once per frame
+// before ticking
+void PollNetClient(void);
+// One predicted tick, does nothing until the server gave this client a ship
+void TickNetClient(unsigned int input);
+// Asks the server for a new game once the current one is over
+void RequestNetRestart(void);
+int GetNetClientPlayer(void);
+NetClientStats GetNetClientStats(void);
+
+#endif // NET_CLIENT_H
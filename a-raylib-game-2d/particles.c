@@ -0,0 +1,160 @@
+#include "particles.h"
+#include <math.h>
+#include "rng.h"
+#include "projectile_kernels.h"
+#include "sprite_batch.h"
+
+// Share of its velocity a particle keeps after a second
+#define PARTICLE_DRAG 0.1f
+
+// How each emitter throws its particles. Speeds are per second and spread
+// is the angle either side of the direction.
+typedef struct {
+    float speedMin;
+    float speedMax;
+    float spread;
+    float lifeMin;
+    float lifeMax;
+    float sizeMin;
+    float sizeMax;
+    Color colors[2];  // Each particle picks a blend between the two
+} EmitterSettings;
+
+static const EmitterSettings emitterSettings[PARTICLE_EMITTER_COUNT] = {
+    [PARTICLE_JET] = {
+        .speedMin = 60, .speedMax = 140, .spread = 0.35f,
+        .lifeMin = 0.25f, .lifeMax = 0.5f, .sizeMin = 3, .sizeMax = 6,
+        .colors = { { 255, 210, 90, 255 }, { 255, 90, 20, 255 } }
+    },
+    [PARTICLE_IMPACT] = {
+        .speedMin = 80, .speedMax = 260, .spread = 0.9f,
+        .lifeMin = 0.15f, .lifeMax = 0.35f, .sizeMin = 2, .sizeMax = 4,
+        .colors = { { 255, 255, 210, 255 }, { 130, 200, 255, 255 } }
+    },
+    [PARTICLE_EXPLOSION] = {
+        .speedMin = 30, .speedMax = 320, .spread = PI,
+        .lifeMin = 0.4f, .lifeMax = 1.2f, .sizeMin = 3, .sizeMax = 9,
+        .colors = { { 255, 220, 120, 255 }, { 190, 60, 20, 255 } }
+    }
+};
+
+// Live particles are packed in [0, count)
+static float posX[PARTICLE_CAPACITY];
+static float posY[PARTICLE_CAPACITY];
+static float velX[PARTICLE_CAPACITY];
+static float velY[PARTICLE_CAPACITY];
+static float lifetime[PARTICLE_CAPACITY];
+static float fadeRate[PARTICLE_CAPACITY];  // 1 / starting lifetime
+static float size[PARTICLE_CAPACITY];
+static Color color[PARTICLE_CAPACITY];
+static int count = 0;
+static int drawCount = 0;
+static unsigned int aliveMask[ALIVE_MASK_WORDS(PARTICLE_CAPACITY)];
+static RandomStream rng = { 0x2545f4914f6cdd1dULL };
+
+// Visible particles with their faded tint, handed to the sprite stream
+static float drawX[PARTICLE_CAPACITY];
+static float drawY[PARTICLE_CAPACITY];
+static float drawSize[PARTICLE_CAPACITY];
+static Color drawTint[PARTICLE_CAPACITY];
+
+static float RandomRange(float min, float max) {
+    return min + GetRandomStreamFloat(&rng) * (max - min);
+}
+
+static Color BlendColor(Color a, Color b, float t) {
+    return (Color){
+        (unsigned char)(a.r + (b.r - a.r) * t),
+        (unsigned char)(a.g + (b.g - a.g) * t),
+        (unsigned char)(a.b + (b.b - a.b) * t),
+        (unsigned char)(a.a + (b.a - a.a) * t)
+    };
+}
+
+static void RemoveParticle(int index) {
+    int from = --count;
+    if (from == index) return;
+
+    posX[index] = posX[from];
+    posY[index] = posY[from];
+    velX[index] = velX[from];
+    velY[index] = velY[from];
+    lifetime[index] = lifetime[from];
+    fadeRate[index] = fadeRate[from];
+    size[index] = size[from];
+    color[index] = color[from];
+}
+
+void ClearParticles(void) {
+    count = 0;
+}
+
+void EmitParticles(ParticleEmitter emitter, Vector2 position, Vector2 direction, int amount) {
+    const EmitterSettings* settings = &emitterSettings[emitter];
+    float heading = atan2f(direction.y, direction.x);
+
+    if (amount > PARTICLE_CAPACITY - count) amount = PARTICLE_CAPACITY - count;
+    for (int n = 0; n < amount; n++) {
+        int i = count++;
+        float angle = heading + RandomRange(-settings->spread, settings->spread);
+        float speed = RandomRange(settings->speedMin, settings->speedMax);
+        float life = RandomRange(settings->lifeMin, settings->lifeMax);
+        float blend = GetRandomStreamFloat(&rng);
+
+        posX[i] = position.x;
+        posY[i] = position.y;
+        velX[i] = cosf(angle) * speed;
+        velY[i] = sinf(angle) * speed;
+        lifetime[i] = life;
+        fadeRate[i] = 1.0f / life;
+        size[i] = RandomRange(settings->sizeMin, settings->sizeMax);
+        color[i] = BlendColor(settings->colors[0], settings->colors[1], blend);
+    }
+}
+
+void UpdateParticles(float deltaTime) {
+    if (count == 0) return;
+
+    float drag = powf(PARTICLE_DRAG, deltaTime);
+    int alive = IntegrateParticles(posX, posY, velX, velY, lifetime, drag, deltaTime, count, aliveMask);
+
+    // Backwards so the particle swapped in has already been checked
+    for (int i = count - 1; i >= 0 && alive < count; i--) {
+        if (!IsProjectileAlive(aliveMask, i)) RemoveParticle(i);
+    }
+}
+
+void DrawParticles(Rectangle view) {
+    float left = view.x;
+    float top = view.y;
+    float right = view.x + view.width;
+    float bottom = view.y + view.height;
+
+    int visible = 0;
+    for (int i = 0; i < count; i++) {
+        float half = size[i] / 2;
+        if (posX[i] + half < left || posX[i] - half > right ||
+            posY[i] + half < top || posY[i] - half > bottom) {
+            continue;
+        }
+
+        float fade = lifetime[i] * fadeRate[i];
+        drawX[visible] = posX[i];
+        drawY[visible] = posY[i];
+        drawSize[visible] = size[i];
+        drawTint[visible] = color[i];
+        drawTint[visible].a = (unsigned char)(color[i].a * fade);
+        visible++;
+    }
+
+    DrawSpriteStream(SPRITE_CIRCLE, drawX, drawY, drawSize, drawTint, visible);
+    drawCount = visible;
+}
+
+int GetParticleCount(void) {
+    return count;
+}
+
+int GetParticleDrawCount(void) {
+    return drawCount;
+}
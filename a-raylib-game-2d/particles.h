@@ -0,0 +1,36 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "raylib.h"
+
+// Purely visual particles for the frontend. They live outside the
+// simulation, advance with the frame time and never affect gameplay.
+// Storage is structure-of-arrays so one SIMD kernel moves them all, and
+// they are drawn as a single sprite stream.
+
+#ifndef PARTICLE_CAPACITY
+#define PARTICLE_CAPACITY 131072
+#endif
+
+#define JET_PARTICLES_PER_SECOND 240
+
+typedef enum {
+    PARTICLE_JET,        // Exhaust trailing a moving ship
+    PARTICLE_IMPACT,     // Sparks where a beam hits something
+    PARTICLE_EXPLOSION,  // Debris and fire when something is destroyed
+    PARTICLE_EMITTER_COUNT
+} ParticleEmitter;
+
+void ClearParticles(void);
+// Spawns count particles heading roughly along direction, which only needs
+// to be non-zero for emitters with a narrow spread. Particles that do not
+// fit are dropped.
+void EmitParticles(ParticleEmitter emitter, Vector2 position, Vector2 direction, int count);
+void UpdateParticles(float deltaTime);
+// Draws particles overlapping view, call between BeginSpriteBatch and
+// EndSpriteBatch
+void DrawParticles(Rectangle view);
+int GetParticleCount(void);
+int GetParticleDrawCount(void);  // Particles drawn by the last DrawParticles
+
+#endif // PARTICLES_H
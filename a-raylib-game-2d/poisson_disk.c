@@ -0,0 +1,127 @@
+#include "poisson_disk.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI_2 6.28318531f
+
+// A cell is small enough that no two points can share it
+static float GetCellSize(float minDistance) {
+    return minDistance / sqrtf(2.0f);
+}
+
+int GetPoissonDiskCellCount(float width, float height, float minDistance) {
+    float cellSize = GetCellSize(minDistance);
+    return (int)ceilf(width / cellSize) * (int)ceilf(height / cellSize);
+}
+
+void InitPoissonDisk(PoissonDisk* disk, int maxCells) {
+    disk->maxCells = maxCells;
+    disk->count = 0;
+    disk->cells = malloc(sizeof(int) * maxCells);
+    disk->active = malloc(sizeof(int) * maxCells);
+    disk->points = malloc(sizeof(Vector2) * maxCells);
+}
+
+void UnloadPoissonDisk(PoissonDisk* disk) {
+    free(disk->cells);
+    free(disk->active);
+    free(disk->points);
+    *disk = (PoissonDisk){ 0 };
+}
+
+int SamplePoissonDisk(PoissonDisk* disk, RandomStream* rng, Rectangle area, float minDistance) {
+    disk->count = 0;
+    if (area.width <= 0 || area.height <= 0 || minDistance <= 0) return 0;
+
+    float cellSize = GetCellSize(minDistance);
+    int cols = (int)ceilf(area.width / cellSize);
+    int rows = (int)ceilf(area.height / cellSize);
+    if (cols * rows > disk->maxCells) return 0;
+
+    memset(disk->cells, 0, sizeof(int) * cols * rows);
+    float minDistanceSqr = minDistance * minDistance;
+
+    // Start anywhere, then keep growing from points that still have room
+    Vector2 first = {
+        area.x + GetRandomStreamFloat(rng) * area.width,
+        area.y + GetRandomStreamFloat(rng) * area.height
+    };
+    disk->points[0] = first;
+    disk->cells[(int)((first.y - area.y) / cellSize) * cols + (int)((first.x - area.x) / cellSize)] = 1;
+    disk->active[0] = 0;
+    disk->count = 1;
+    int activeCount = 1;
+
+    // Candidates sit just outside minDistance at evenly spaced angles from a
+    // random start, stepping the direction by a fixed rotation instead of
+    // drawing a new angle each time. That packs tighter and needs no trig
+    // in the loop.
+    float radius = minDistance * 1.0001f;
+    float stepCos = cosf(PI_2 / POISSON_DISK_ATTEMPTS);
+    float stepSin = sinf(PI_2 / POISSON_DISK_ATTEMPTS);
+
+    while (activeCount > 0) {
+        int a = GetRandomStreamValue(rng, 0, activeCount - 1);
+        Vector2 from = disk->points[disk->active[a]];
+        float angle = GetRandomStreamFloat(rng) * PI_2;
+        Vector2 dir = { cosf(angle), sinf(angle) };
+
+        bool placed = false;
+        for (int attempt = 0; attempt < POISSON_DISK_ATTEMPTS && !placed; attempt++) {
+            Vector2 candidate = { from.x + dir.x * radius, from.y + dir.y * radius };
+            dir = (Vector2){ dir.x * stepCos - dir.y * stepSin, dir.x * stepSin + dir.y * stepCos };
+
+            float localX = candidate.x - area.x;
+            float localY = candidate.y - area.y;
+            if (localX < 0 || localY < 0 || localX >= area.width || localY >= area.height) continue;
+
+            int cellX = (int)(localX / cellSize);
+            int cellY = (int)(localY / cellSize);
+            if (cellX >= cols || cellY >= rows || disk->cells[cellY * cols + cellX] != 0) continue;
+
+            // Anything closer than minDistance is at most two cells away, and
+            // never in the corners of that 5x5 block
+            bool clear = true;
+            for (int y = cellY - 2; y <= cellY + 2 && clear; y++) {
+                if (y < 0 || y >= rows) continue;
+                for (int x = cellX - 2; x <= cellX + 2; x++) {
+                    if (x < 0 || x >= cols) continue;
+                    if ((x == cellX - 2 || x == cellX + 2) && (y == cellY - 2 || y == cellY + 2)) continue;
+                    int other = disk->cells[y * cols + x];
+                    if (other == 0) continue;
+
+                    float dx = disk->points[other - 1].x - candidate.x;
+                    float dy = disk->points[other - 1].y - candidate.y;
+                    if (dx*dx + dy*dy < minDistanceSqr) {
+                        clear = false;
+                        break;
+                    }
+                }
+            }
+            if (!clear) continue;
+
+            int index = disk->count++;
+            disk->points[index] = candidate;
+            disk->cells[cellY * cols + cellX] = index + 1;
+            disk->active[activeCount++] = index;
+            placed = true;
+        }
+
+        // Nothing fits around this point any more
+        if (!placed) disk->active[a] = disk->active[--activeCount];
+    }
+
+    return disk->count;
+}
+
+void ShufflePoissonDisk(PoissonDisk* disk, RandomStream* rng, int count) {
+    if (count > disk->count) count = disk->count;
+
+    for (int i = 0; i < count; i++) {
+        int j = GetRandomStreamValue(rng, i, disk->count - 1);
+        Vector2 swap = disk->points[i];
+        disk->points[i] = disk->points[j];
+        disk->points[j] = swap;
+    }
+}
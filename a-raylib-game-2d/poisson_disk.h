@@ -0,0 +1,35 @@
+#ifndef POISSON_DISK_H
+#define POISSON_DISK_H
+
+#include "raylib.h"
+#include "rng.h"
+
+// Bridson's Poisson-disk sampling: fills an area with points that are all
+// at least minDistance apart, without retrying whole placements. A
+// background grid with one point per cell makes every distance check look
+// at a few cells, and every point gets a fixed number of tries to grow a
+// neighbour before it retires, so a fill always ends in linear time.
+#define POISSON_DISK_ATTEMPTS 30
+
+typedef struct {
+    int maxCells;
+    int count;
+    int* cells;       // Grid cell -> point index + 1, 0 when empty
+    int* active;      // Points that may still have room around them
+    Vector2* points;  // Placed points, maxCells at most
+} PoissonDisk;
+
+// Grid cells a fill of the area needs, pass the largest one to InitPoissonDisk
+int GetPoissonDiskCellCount(float width, float height, float minDistance);
+
+void InitPoissonDisk(PoissonDisk* disk, int maxCells);
+void UnloadPoissonDisk(PoissonDisk* disk);
+// Fills area until no more points fit and returns how many, they are left
+// in disk->points. Returns 0 if the area needs more cells than the disk has.
+// The same rng state always gives the same points.
+int SamplePoissonDisk(PoissonDisk* disk, RandomStream* rng, Rectangle area, float minDistance);
+// Moves count points picked at random from the last fill to the front, so
+// a prefix is spread over the whole area instead of around the first point
+void ShufflePoissonDisk(PoissonDisk* disk, RandomStream* rng, int count);
+
+#endif // POISSON_DISK_H
@@ -0,0 +1,181 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// One run of a zone, kept until the frame is written to the capture
+typedef struct {
+    ProfileZone zone;
+    double start;     // Monotonic clock, milliseconds
+    double duration;  // Milliseconds
+} ProfileEvent;
+
+static const char* zoneNames[PROFILE_ZONE_COUNT] = {
+    [PROFILE_INPUT] = "Input",
+    [PROFILE_BEAMS] = "Beams",
+    [PROFILE_WORLD] = "World",
+    [PROFILE_COLLISIONS] = "Collisions",
+    [PROFILE_AI] = "AI",
+    [PROFILE_AI_BEAMS] = "AI beams",
+    [PROFILE_PARTICLES] = "Particles",
+    [PROFILE_DRAW_BACKGROUND] = "Draw background",
+    [PROFILE_DRAW_PARTICLES] = "Draw particles",
+    [PROFILE_DRAW_PLAYER] = "Draw player",
+    [PROFILE_DRAW_COINS] = "Draw coins",
+    [PROFILE_DRAW_ASTEROIDS] = "Draw asteroids",
+    [PROFILE_DRAW_BEAMS] = "Draw beams",
+    [PROFILE_DRAW_STATIONS] = "Draw stations",
+    [PROFILE_DRAW_AI] = "Draw AI",
+    [PROFILE_DRAW_FLUSH] = "Draw flush",
+    [PROFILE_DRAW_HUD] = "Draw HUD"
+};
+
+static double frameStart = 0.0;
+static double zoneStart[PROFILE_ZONE_COUNT];
+static double zoneTime[PROFILE_ZONE_COUNT];  // This frame so far
+static ProfileEvent events[PROFILE_MAX_EVENTS];
+static int eventCount = 0;
+
+// Ring of the last frames, with running sums for the zone averages
+static float frameHistory[PROFILE_HISTORY];
+static float zoneHistory[PROFILE_HISTORY][PROFILE_ZONE_COUNT];
+static double zoneSums[PROFILE_ZONE_COUNT];
+static int historyHead = 0;
+static int historyCount = 0;
+static long long frameNumber = 0;
+
+static FILE* captureFile = NULL;
+static bool captureJson = false;
+static bool captureHasEvents = false;
+
+static double GetMilliseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void BeginProfileFrame(void) {
+    frameStart = GetMilliseconds();
+    memset(zoneTime, 0, sizeof(zoneTime));
+    eventCount = 0;
+}
+
+void BeginProfileZone(ProfileZone zone) {
+    zoneStart[zone] = GetMilliseconds();
+}
+
+void EndProfileZone(ProfileZone zone) {
+    double duration = GetMilliseconds() - zoneStart[zone];
+    zoneTime[zone] += duration;
+
+    if (eventCount < PROFILE_MAX_EVENTS) {
+        events[eventCount++] = (ProfileEvent){ zone, zoneStart[zone], duration };
+    }
+}
+
+static void WriteTraceEvent(const char* name, double start, double duration) {
+    fprintf(captureFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+        captureHasEvents ? "," : "", name, start * 1e3, duration * 1e3);
+    captureHasEvents = true;
+}
+
+static void WriteCapturedFrame(double frameTime) {
+    if (captureJson) {
+        WriteTraceEvent("Frame", frameStart, frameTime);
+        for (int e = 0; e < eventCount; e++) {
+            WriteTraceEvent(zoneNames[events[e].zone], events[e].start, events[e].duration);
+        }
+        return;
+    }
+
+    fprintf(captureFile, "%lld,%.4f", frameNumber, frameTime);
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        fprintf(captureFile, ",%.4f", zoneTime[z]);
+    }
+    fputc('\n', captureFile);
+}
+
+void EndProfileFrame(void) {
+    double frameTime = GetMilliseconds() - frameStart;
+
+    // The oldest frame drops out of the sums as the newest goes in
+    int slot = historyHead;
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        if (historyCount == PROFILE_HISTORY) zoneSums[z] -= zoneHistory[slot][z];
+        zoneHistory[slot][z] = (float)zoneTime[z];
+        zoneSums[z] += zoneTime[z];
+    }
+    frameHistory[slot] = (float)frameTime;
+    historyHead = (historyHead + 1) % PROFILE_HISTORY;
+    if (historyCount < PROFILE_HISTORY) historyCount++;
+
+    if (captureFile != NULL) WriteCapturedFrame(frameTime);
+    frameNumber++;
+}
+
+const char* GetProfileZoneName(ProfileZone zone) {
+    return zoneNames[zone];
+}
+
+int GetProfileFrameTimes(float* frameMs, int maxFrames) {
+    int count = historyCount < maxFrames ? historyCount : maxFrames;
+    int first = (historyHead - count + PROFILE_HISTORY) % PROFILE_HISTORY;
+    for (int i = 0; i < count; i++) {
+        frameMs[i] = frameHistory[(first + i) % PROFILE_HISTORY];
+    }
+    return count;
+}
+
+static int CompareFloats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+float GetProfileFramePercentile(float percentile) {
+    if (historyCount == 0) return 0.0f;
+
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, frameHistory, sizeof(float) * historyCount);
+    qsort(sorted, historyCount, sizeof(float), CompareFloats);
+
+    int index = (int)(percentile * (historyCount - 1) + 0.5f);
+    if (index < 0) index = 0;
+    if (index >= historyCount) index = historyCount - 1;
+    return sorted[index];
+}
+
+float GetProfileZoneAverage(ProfileZone zone) {
+    return historyCount > 0 ? (float)(zoneSums[zone] / historyCount) : 0.0f;
+}
+
+bool BeginProfileCapture(const char* path) {
+    EndProfileCapture();
+
+    captureFile = fopen(path, "w");
+    if (captureFile == NULL) return false;
+
+    size_t length = strlen(path);
+    captureJson = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+    captureHasEvents = false;
+
+    if (captureJson) {
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", captureFile);
+    } else {
+        fputs("frame,frame_ms", captureFile);
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+            fprintf(captureFile, ",%s", zoneNames[z]);
+        }
+        fputc('\n', captureFile);
+    }
+    return true;
+}
+
+void EndProfileCapture(void) {
+    if (captureFile == NULL) return;
+
+    if (captureJson) fputs("\n]}\n", captureFile);
+    fclose(captureFile);
+    captureFile = NULL;
+}
@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+// Frame profiler. Zones are timed with Begin/End pairs on the main thread
+// and add up when they run several times in a frame, such as the
+// simulation zones when a frame runs more than one tick. The last
+// PROFILE_HISTORY frames are kept for the overlay, and a capture streams
+// every frame to a file for offline analysis.
+#define PROFILE_HISTORY 240
+#define PROFILE_MAX_EVENTS 512  // Zone runs kept per frame for traces
+
+typedef enum {
+    PROFILE_INPUT,
+    PROFILE_BEAMS,
+    PROFILE_WORLD,
+    PROFILE_COLLISIONS,
+    PROFILE_AI,
+    PROFILE_AI_BEAMS,
+    PROFILE_PARTICLES,
+    PROFILE_DRAW_BACKGROUND,
+    PROFILE_DRAW_PARTICLES,
+    PROFILE_DRAW_PLAYER,
+    PROFILE_DRAW_COINS,
+    PROFILE_DRAW_ASTEROIDS,
+    PROFILE_DRAW_BEAMS,
+    PROFILE_DRAW_STATIONS,
+    PROFILE_DRAW_AI,
+    PROFILE_DRAW_FLUSH,
+    PROFILE_DRAW_HUD,
+    PROFILE_ZONE_COUNT
+} ProfileZone;
+
+void BeginProfileFrame(void);
+void EndProfileFrame(void);
+void BeginProfileZone(ProfileZone zone);
+void EndProfileZone(ProfileZone zone);
+
+const char* GetProfileZoneName(ProfileZone zone);
+// Milliseconds of the kept frames, oldest first, returns how many
+int GetProfileFrameTimes(float* frameMs, int maxFrames);
+// Frame time in milliseconds that the given share of kept frames stay under
+float GetProfileFramePercentile(float percentile);
+// Average milliseconds per frame spent in zone over the kept frames
+float GetProfileZoneAverage(ProfileZone zone);
+
+// Streams every frame from now on to path, as Chrome trace JSON when the
+// name ends in .json and as CSV with a column per zone otherwise
+bool BeginProfileCapture(const char* path);
+void EndProfileCapture(void);
+
+#endif // PROFILER_H
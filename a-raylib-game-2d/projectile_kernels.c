@@ -0,0 +1,334 @@
+#include "projectile_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PROJECTILE_KERNELS_X86 1
+#endif
+
+typedef int (*ProjectileKernel)(float*, float*, const float*, const float*,
+                                float*, float, int, unsigned int*);
+typedef int (*ParticleKernel)(float*, float*, float*, float*,
+                              float*, float, float, int, unsigned int*);
+typedef int (*SweepKernel)(const float*, const float*, const float*, const float*,
+                           int, float, float, float, unsigned int*);
+
+// Keeps the closest point search finite for projectiles that did not move
+#define SWEEP_MIN_LENGTH_SQ 1e-12f
+
+static int UpdateProjectilesScalar(float* posX, float* posY, const float* velX, const float* velY,
+                                   float* lifetime, float deltaTime, int start, int count,
+                                   unsigned int* aliveMask) {
+    int alive = 0;
+
+    for (int i = start; i < count; i++) {
+        posX[i] += velX[i];
+        posY[i] += velY[i];
+        lifetime[i] -= deltaTime;
+        if (lifetime[i] > 0) {
+            aliveMask[i >> 5] |= 1u << (i & 31);
+            alive++;
+        }
+    }
+
+    return alive;
+}
+
+static int IntegrateParticlesScalar(float* posX, float* posY, float* velX, float* velY,
+                                    float* lifetime, float drag, float deltaTime, int start, int count,
+                                    unsigned int* aliveMask) {
+    int alive = 0;
+
+    for (int i = start; i < count; i++) {
+        posX[i] += velX[i] * deltaTime;
+        posY[i] += velY[i] * deltaTime;
+        velX[i] *= drag;
+        velY[i] *= drag;
+        lifetime[i] -= deltaTime;
+        if (lifetime[i] > 0) {
+            aliveMask[i >> 5] |= 1u << (i & 31);
+            alive++;
+        }
+    }
+
+    return alive;
+}
+
+// Closest point of the step to the center, with the step parameter clamped
+// to [0, 1]. The SIMD kernels do the same operations in the same order.
+static int SweepProjectilesScalar(const float* posX, const float* posY, const float* velX, const float* velY,
+                                  int start, int count, float centerX, float centerY, float radius,
+                                  unsigned int* hitMask) {
+    float radiusSq = radius * radius;
+    int hits = 0;
+
+    for (int i = start; i < count; i++) {
+        float fromX = posX[i] - velX[i] - centerX;
+        float fromY = posY[i] - velY[i] - centerY;
+        float lengthSq = velX[i] * velX[i] + velY[i] * velY[i];
+        float along = fromX * velX[i] + fromY * velY[i];
+        float t = -along / fmaxf(lengthSq, SWEEP_MIN_LENGTH_SQ);
+        t = fminf(fmaxf(t, 0.0f), 1.0f);
+        float closestX = fromX + t * velX[i];
+        float closestY = fromY + t * velY[i];
+        if (closestX * closestX + closestY * closestY <= radiusSq) {
+            hitMask[i >> 5] |= 1u << (i & 31);
+            hits++;
+        }
+    }
+
+    return hits;
+}
+
+static int ScalarKernel(float* posX, float* posY, const float* velX, const float* velY,
+                        float* lifetime, float deltaTime, int count, unsigned int* aliveMask) {
+    return UpdateProjectilesScalar(posX, posY, velX, velY, lifetime, deltaTime, 0, count, aliveMask);
+}
+
+static int ScalarParticleKernel(float* posX, float* posY, float* velX, float* velY,
+                                float* lifetime, float drag, float deltaTime, int count,
+                                unsigned int* aliveMask) {
+    return IntegrateParticlesScalar(posX, posY, velX, velY, lifetime, drag, deltaTime, 0, count, aliveMask);
+}
+
+static int ScalarSweepKernel(const float* posX, const float* posY, const float* velX, const float* velY,
+                             int count, float centerX, float centerY, float radius, unsigned int* hitMask) {
+    return SweepProjectilesScalar(posX, posY, velX, velY, 0, count, centerX, centerY, radius, hitMask);
+}
+
+#ifdef PROJECTILE_KERNELS_X86
+__attribute__((target("sse2")))
+static int SSE2Kernel(float* posX, float* posY, const float* velX, const float* velY,
+                      float* lifetime, float deltaTime, int count, unsigned int* aliveMask) {
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 zero = _mm_setzero_ps();
+    int alive = 0;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(posX + i, _mm_add_ps(_mm_loadu_ps(posX + i), _mm_loadu_ps(velX + i)));
+        _mm_storeu_ps(posY + i, _mm_add_ps(_mm_loadu_ps(posY + i), _mm_loadu_ps(velY + i)));
+
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(lifetime + i), dt);
+        _mm_storeu_ps(lifetime + i, life);
+
+        unsigned int bits = (unsigned int)_mm_movemask_ps(_mm_cmpgt_ps(life, zero));
+        aliveMask[i >> 5] |= bits << (i & 31);
+        alive += __builtin_popcount(bits);
+    }
+
+    return alive + UpdateProjectilesScalar(posX, posY, velX, velY, lifetime, deltaTime, i, count, aliveMask);
+}
+
+__attribute__((target("avx2")))
+static int AVX2Kernel(float* posX, float* posY, const float* velX, const float* velY,
+                      float* lifetime, float deltaTime, int count, unsigned int* aliveMask) {
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    __m256 zero = _mm256_setzero_ps();
+    int alive = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(posX + i, _mm256_add_ps(_mm256_loadu_ps(posX + i), _mm256_loadu_ps(velX + i)));
+        _mm256_storeu_ps(posY + i, _mm256_add_ps(_mm256_loadu_ps(posY + i), _mm256_loadu_ps(velY + i)));
+
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(lifetime + i), dt);
+        _mm256_storeu_ps(lifetime + i, life);
+
+        unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_GT_OQ));
+        aliveMask[i >> 5] |= bits << (i & 31);
+        alive += __builtin_popcount(bits);
+    }
+
+    // GCC does not insert this for target("avx2") functions, without it the
+    // SSE code that runs next on this thread pays for dirty upper registers
+    _mm256_zeroupper();
+
+    return alive + UpdateProjectilesScalar(posX, posY, velX, velY, lifetime, deltaTime, i, count, aliveMask);
+}
+
+__attribute__((target("sse2")))
+static int SSE2ParticleKernel(float* posX, float* posY, float* velX, float* velY,
+                              float* lifetime, float drag, float deltaTime, int count,
+                              unsigned int* aliveMask) {
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 damping = _mm_set1_ps(drag);
+    __m128 zero = _mm_setzero_ps();
+    int alive = 0;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(velX + i);
+        __m128 vy = _mm_loadu_ps(velY + i);
+        _mm_storeu_ps(posX + i, _mm_add_ps(_mm_loadu_ps(posX + i), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(posY + i, _mm_add_ps(_mm_loadu_ps(posY + i), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(velX + i, _mm_mul_ps(vx, damping));
+        _mm_storeu_ps(velY + i, _mm_mul_ps(vy, damping));
+
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(lifetime + i), dt);
+        _mm_storeu_ps(lifetime + i, life);
+
+        unsigned int bits = (unsigned int)_mm_movemask_ps(_mm_cmpgt_ps(life, zero));
+        aliveMask[i >> 5] |= bits << (i & 31);
+        alive += __builtin_popcount(bits);
+    }
+
+    return alive + IntegrateParticlesScalar(posX, posY, velX, velY, lifetime, drag, deltaTime, i, count, aliveMask);
+}
+
+__attribute__((target("avx2")))
+static int AVX2ParticleKernel(float* posX, float* posY, float* velX, float* velY,
+                              float* lifetime, float drag, float deltaTime, int count,
+                              unsigned int* aliveMask) {
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    __m256 damping = _mm256_set1_ps(drag);
+    __m256 zero = _mm256_setzero_ps();
+    int alive = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(velX + i);
+        __m256 vy = _mm256_loadu_ps(velY + i);
+        _mm256_storeu_ps(posX + i, _mm256_add_ps(_mm256_loadu_ps(posX + i), _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(posY + i, _mm256_add_ps(_mm256_loadu_ps(posY + i), _mm256_mul_ps(vy, dt)));
+        _mm256_storeu_ps(velX + i, _mm256_mul_ps(vx, damping));
+        _mm256_storeu_ps(velY + i, _mm256_mul_ps(vy, damping));
+
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(lifetime + i), dt);
+        _mm256_storeu_ps(lifetime + i, life);
+
+        unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_GT_OQ));
+        aliveMask[i >> 5] |= bits << (i & 31);
+        alive += __builtin_popcount(bits);
+    }
+
+    _mm256_zeroupper();
+
+    return alive + IntegrateParticlesScalar(posX, posY, velX, velY, lifetime, drag, deltaTime, i, count, aliveMask);
+}
+
+__attribute__((target("sse2")))
+static int SSE2SweepKernel(const float* posX, const float* posY, const float* velX, const float* velY,
+                           int count, float centerX, float centerY, float radius, unsigned int* hitMask) {
+    __m128 cx = _mm_set1_ps(centerX);
+    __m128 cy = _mm_set1_ps(centerY);
+    __m128 radiusSq = _mm_set1_ps(radius * radius);
+    __m128 minLengthSq = _mm_set1_ps(SWEEP_MIN_LENGTH_SQ);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    int hits = 0;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(velX + i);
+        __m128 vy = _mm_loadu_ps(velY + i);
+        __m128 fromX = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(posX + i), vx), cx);
+        __m128 fromY = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(posY + i), vy), cy);
+        __m128 lengthSq = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        __m128 along = _mm_add_ps(_mm_mul_ps(fromX, vx), _mm_mul_ps(fromY, vy));
+        __m128 t = _mm_div_ps(_mm_sub_ps(zero, along), _mm_max_ps(lengthSq, minLengthSq));
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        __m128 closestX = _mm_add_ps(fromX, _mm_mul_ps(t, vx));
+        __m128 closestY = _mm_add_ps(fromY, _mm_mul_ps(t, vy));
+        __m128 distanceSq = _mm_add_ps(_mm_mul_ps(closestX, closestX), _mm_mul_ps(closestY, closestY));
+
+        unsigned int bits = (unsigned int)_mm_movemask_ps(_mm_cmple_ps(distanceSq, radiusSq));
+        hitMask[i >> 5] |= bits << (i & 31);
+        hits += __builtin_popcount(bits);
+    }
+
+    return hits + SweepProjectilesScalar(posX, posY, velX, velY, i, count, centerX, centerY, radius, hitMask);
+}
+
+__attribute__((target("avx2")))
+static int AVX2SweepKernel(const float* posX, const float* posY, const float* velX, const float* velY,
+                           int count, float centerX, float centerY, float radius, unsigned int* hitMask) {
+    __m256 cx = _mm256_set1_ps(centerX);
+    __m256 cy = _mm256_set1_ps(centerY);
+    __m256 radiusSq = _mm256_set1_ps(radius * radius);
+    __m256 minLengthSq = _mm256_set1_ps(SWEEP_MIN_LENGTH_SQ);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+    int hits = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(velX + i);
+        __m256 vy = _mm256_loadu_ps(velY + i);
+        __m256 fromX = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(posX + i), vx), cx);
+        __m256 fromY = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(posY + i), vy), cy);
+        __m256 lengthSq = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+        __m256 along = _mm256_add_ps(_mm256_mul_ps(fromX, vx), _mm256_mul_ps(fromY, vy));
+        __m256 t = _mm256_div_ps(_mm256_sub_ps(zero, along), _mm256_max_ps(lengthSq, minLengthSq));
+        t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+        __m256 closestX = _mm256_add_ps(fromX, _mm256_mul_ps(t, vx));
+        __m256 closestY = _mm256_add_ps(fromY, _mm256_mul_ps(t, vy));
+        __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(closestX, closestX), _mm256_mul_ps(closestY, closestY));
+
+        unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(distanceSq, radiusSq, _CMP_LE_OQ));
+        hitMask[i >> 5] |= bits << (i & 31);
+        hits += __builtin_popcount(bits);
+    }
+
+    _mm256_zeroupper();
+
+    return hits + SweepProjectilesScalar(posX, posY, velX, velY, i, count, centerX, centerY, radius, hitMask);
+}
+#endif
+
+static ProjectileKernel kernel = NULL;
+static ParticleKernel particleKernel = NULL;
+static SweepKernel sweepKernel = NULL;
+static const char* kernelName = "none";
+
+static void SelectKernel(void) {
+    kernel = ScalarKernel;
+    particleKernel = ScalarParticleKernel;
+    sweepKernel = ScalarSweepKernel;
+    kernelName = "scalar";
+
+#ifdef PROJECTILE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = AVX2Kernel;
+        particleKernel = AVX2ParticleKernel;
+        sweepKernel = AVX2SweepKernel;
+        kernelName = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernel = SSE2Kernel;
+        particleKernel = SSE2ParticleKernel;
+        sweepKernel = SSE2SweepKernel;
+        kernelName = "sse2";
+    }
+#endif
+}
+
+int UpdateProjectiles(float* posX, float* posY, const float* velX, const float* velY,
+                      float* lifetime, float deltaTime, int count, unsigned int* aliveMask) {
+    if (kernel == NULL) SelectKernel();
+
+    memset(aliveMask, 0, sizeof(unsigned int) * ALIVE_MASK_WORDS(count));
+    return kernel(posX, posY, velX, velY, lifetime, deltaTime, count, aliveMask);
+}
+
+int IntegrateParticles(float* posX, float* posY, float* velX, float* velY,
+                       float* lifetime, float drag, float deltaTime, int count, unsigned int* aliveMask) {
+    if (particleKernel == NULL) SelectKernel();
+
+    memset(aliveMask, 0, sizeof(unsigned int) * ALIVE_MASK_WORDS(count));
+    return particleKernel(posX, posY, velX, velY, lifetime, drag, deltaTime, count, aliveMask);
+}
+
+int SweepProjectiles(const float* posX, const float* posY, const float* velX, const float* velY,
+                     int count, float centerX, float centerY, float radius, unsigned int* hitMask) {
+    if (sweepKernel == NULL) SelectKernel();
+
+    memset(hitMask, 0, sizeof(unsigned int) * ALIVE_MASK_WORDS(count));
+    return sweepKernel(posX, posY, velX, velY, count, centerX, centerY, radius, hitMask);
+}
+
+const char* GetProjectileKernelName(void) {
+    if (kernel == NULL) SelectKernel();
+    return kernelName;
+}
@@ -0,0 +1,38 @@
+#ifndef PROJECTILE_KERNELS_H
+#define PROJECTILE_KERNELS_H
+
+#include <stdbool.h>
+
+// Size of the alive mask needed for count projectiles
+#define ALIVE_MASK_WORDS(count) (((count) + 31) / 32)
+
+// Advances projectiles by their velocity, subtracts deltaTime from their
+// lifetimes and sets bit i of aliveMask for every projectile still alive.
+// Returns the number of live projectiles. The AVX2, SSE2 or scalar kernel
+// is picked on first use depending on what the CPU supports.
+int UpdateProjectiles(float* posX, float* posY, const float* velX, const float* velY,
+                      float* lifetime, float deltaTime, int count, unsigned int* aliveMask);
+
+// Same for particles, whose velocities are per second and slowed by drag:
+// moves by velocity * deltaTime, then scales velocity by drag
+int IntegrateParticles(float* posX, float* posY, float* velX, float* velY,
+                       float* lifetime, float drag, float deltaTime, int count, unsigned int* aliveMask);
+
+// Swept test of the step projectiles just took, from position - velocity to
+// position, against one circle. Sets bit i of hitMask for every projectile
+// whose path came within radius of the center and returns how many did, so
+// fast projectiles cannot pass through without a hit.
+int SweepProjectiles(const float* posX, const float* posY, const float* velX, const float* velY,
+                     int count, float centerX, float centerY, float radius, unsigned int* hitMask);
+
+static inline bool IsProjectileAlive(const unsigned int* aliveMask, int index) {
+    return (aliveMask[index >> 5] >> (index & 31)) & 1u;
+}
+
+static inline bool IsProjectileHit(const unsigned int* hitMask, int index) {
+    return (hitMask[index >> 5] >> (index & 31)) & 1u;
+}
+
+const char* GetProjectileKernelName(void);
+
+#endif // PROJECTILE_KERNELS_H
@@ -0,0 +1,171 @@
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define REPLAY_INITIAL_CAPACITY 4096
+
+// Header fields at fixed offsets, written byte by byte so the file is the
+// same on every compiler and platform
+static void PutU16(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void PutU32(unsigned char* out, uint32_t value) {
+    PutU16(out, value);
+    PutU16(out + 2, value >> 16);
+}
+
+static uint32_t GetU16(const unsigned char* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8);
+}
+
+static uint32_t GetU32(const unsigned char* in) {
+    return GetU16(in) | (GetU16(in + 2) << 16);
+}
+
+static void PutByte(Replay* replay, unsigned char byte) {
+    if (replay->size == replay->capacity) {
+        replay->capacity = replay->capacity ? replay->capacity * 2 : REPLAY_INITIAL_CAPACITY;
+        replay->data = realloc(replay->data, replay->capacity);
+    }
+    replay->data[replay->size++] = byte;
+}
+
+// LEB128, runs shorter than two seconds take a single byte
+static void PutVarint(Replay* replay, unsigned long long value) {
+    while (value >= 0x80) {
+        PutByte(replay, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    PutByte(replay, (unsigned char)value);
+}
+
+static bool GetVarint(Replay* replay, unsigned long long* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && replay->cursor < replay->size; shift += 7) {
+        unsigned char byte = replay->data[replay->cursor++];
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Writes out the run in progress, the next tick starts a new one
+static void FlushRun(Replay* replay) {
+    if (replay->runTicks == 0) return;
+
+    PutByte(replay, (unsigned char)replay->input);
+    PutVarint(replay, (unsigned long long)replay->runTicks);
+    replay->runTicks = 0;
+}
+
+void BeginReplayRecording(Replay* replay, GameConfig config) {
+    UnloadReplay(replay);
+    replay->info = (ReplayInfo){
+        .config = config,
+        .tickRate = SIM_TICK_RATE,
+        .ticks = 0
+    };
+}
+
+void RecordReplayTick(Replay* replay, unsigned int input) {
+    input &= REPLAY_INPUT_MASK;
+    if (replay->runTicks > 0 && input != replay->input) FlushRun(replay);
+
+    replay->input = input;
+    replay->runTicks++;
+    replay->info.ticks++;
+}
+
+void RecordReplayReset(Replay* replay) {
+    FlushRun(replay);
+    PutByte(replay, REPLAY_RESET);
+}
+
+bool SaveReplay(Replay* replay, const char* path) {
+    FlushRun(replay);
+
+    const GameConfig* config = &replay->info.config;
+    unsigned char header[REPLAY_HEADER_SIZE] = { 0 };
+    memcpy(header, REPLAY_MAGIC, 4);
+    PutU16(header + 4, REPLAY_VERSION);
+    PutU16(header + 6, (uint32_t)replay->info.tickRate);
+    PutU32(header + 8, config->seed);
+    PutU32(header + 12, (uint32_t)config->coinsPerChunk);
+    PutU32(header + 16, (uint32_t)config->asteroidsPerChunk);
+    PutU32(header + 20, (uint32_t)config->aiShipCount);
+    PutU32(header + 24, (uint32_t)replay->info.ticks);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                   (replay->size == 0 || fwrite(replay->data, 1, replay->size, file) == (size_t)replay->size);
+    return fclose(file) == 0 && written;
+}
+
+bool LoadReplay(Replay* replay, const char* path) {
+    UnloadReplay(replay);
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+                 memcmp(header, REPLAY_MAGIC, 4) == 0 &&
+                 GetU16(header + 4) == REPLAY_VERSION &&
+                 GetU16(header + 6) == SIM_TICK_RATE;
+    if (!valid) {
+        fclose(file);
+        return false;
+    }
+
+    GameConfig config = GetDefaultGameConfig();
+    config.seed = GetU32(header + 8);
+    config.coinsPerChunk = (int)GetU32(header + 12);
+    config.asteroidsPerChunk = (int)GetU32(header + 16);
+    config.aiShipCount = (int)GetU32(header + 20);
+    replay->info = (ReplayInfo){
+        .config = config,
+        .tickRate = (int)GetU16(header + 6),
+        .ticks = GetU32(header + 24)
+    };
+
+    // The rest of the file is the input stream
+    long start = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file) - start;
+    fseek(file, start, SEEK_SET);
+
+    replay->capacity = size > 0 ? (int)size : 1;
+    replay->data = malloc(replay->capacity);
+    replay->size = (int)fread(replay->data, 1, size, file);
+    fclose(file);
+    return replay->size == size;
+}
+
+ReplayStep NextReplayStep(Replay* replay, unsigned int* input) {
+    while (replay->runTicks == 0) {
+        if (replay->cursor >= replay->size) return REPLAY_STEP_END;
+
+        unsigned char code = replay->data[replay->cursor++];
+        if (code == REPLAY_RESET) return REPLAY_STEP_RESET;
+
+        unsigned long long run;
+        if (!GetVarint(replay, &run)) return REPLAY_STEP_END;
+        replay->input = code;
+        replay->runTicks = (long long)run;
+    }
+
+    replay->runTicks--;
+    *input = replay->input;
+    return REPLAY_STEP_TICK;
+}
+
+void UnloadReplay(Replay* replay) {
+    free(replay->data);
+    *replay = (Replay){ 0 };
+}
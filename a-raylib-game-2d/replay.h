@@ -0,0 +1,55 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Recorded sessions. The simulation is deterministic, so the config it was
+// started with and the input of every tick are enough to play a session
+// back exactly. The file is a fixed little-endian header followed by the
+// input stream, stored as changes: an entry is the new input byte and a
+// varint count of the ticks it was held for. ResetGame between ticks is an
+// entry of its own.
+#define REPLAY_MAGIC "SCRP"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 32
+#define REPLAY_RESET 0x80       // Entry code for a ResetGame
+#define REPLAY_INPUT_MASK 0x7f  // Input bits that are stored
+
+typedef enum {
+    REPLAY_STEP_TICK,   // Run one UpdateGame with the input
+    REPLAY_STEP_RESET,  // Call ResetGame
+    REPLAY_STEP_END
+} ReplayStep;
+
+// The worker count and broad phase are not stored, they do not change the
+// results
+typedef struct {
+    GameConfig config;
+    int tickRate;
+    long long ticks;
+} ReplayInfo;
+
+typedef struct {
+    ReplayInfo info;
+    unsigned char* data;  // Encoded input stream, without the header
+    int size;
+    int capacity;
+    int cursor;           // Read position while playing
+    unsigned int input;   // Input of the current run
+    long long runTicks;   // Ticks recorded into, or left in, the current run
+} Replay;
+
+// Recording, call RecordReplayTick once for every UpdateGame
+void BeginReplayRecording(Replay* replay, GameConfig config);
+void RecordReplayTick(Replay* replay, unsigned int input);
+void RecordReplayReset(Replay* replay);
+bool SaveReplay(Replay* replay, const char* path);
+
+// Playback, fails on files from another version or tick rate
+bool LoadReplay(Replay* replay, const char* path);
+ReplayStep NextReplayStep(Replay* replay, unsigned int* input);
+
+void UnloadReplay(Replay* replay);
+
+#endif // REPLAY_H
@@ -0,0 +1,51 @@
+#include "rng.h"
+
+// PCG32, small state and good enough statistics for gameplay
+static const uint64_t increment = 0xda3e39cb94b95bdbULL;
+static RandomStream simStream = { 0x853c49e6748fea9bULL };
+
+static uint32_t NextRandom(RandomStream* stream) {
+    uint64_t old = stream->state;
+    stream->state = old * 6364136223846793005ULL + increment;
+    uint32_t xorShifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+    uint32_t rot = (uint32_t)(old >> 59u);
+    return (xorShifted >> rot) | (xorShifted << ((-rot) & 31));
+}
+
+void SeedRandomStream(RandomStream* stream, uint64_t seed) {
+    stream->state = 0;
+    NextRandom(stream);
+    stream->state += seed;
+    NextRandom(stream);
+}
+
+int GetRandomStreamValue(RandomStream* stream, int min, int max) {
+    if (min > max) {
+        int tmp = max;
+        max = min;
+        min = tmp;
+    }
+
+    uint32_t range = (uint32_t)(max - min) + 1u;
+    return min + (int)(NextRandom(stream) % range);
+}
+
+float GetRandomStreamFloat(RandomStream* stream) {
+    return (NextRandom(stream) >> 8) * (1.0f / 16777216.0f);
+}
+
+void SeedSimRandom(unsigned int seed) {
+    SeedRandomStream(&simStream, seed);
+}
+
+StateRegion GetSimRandomStateRegion(void) {
+    return (StateRegion){ &simStream, sizeof(simStream) };
+}
+
+int GetSimRandomValue(int min, int max) {
+    return GetRandomStreamValue(&simStream, min, max);
+}
+
+float GetSimRandomFloat(void) {
+    return GetRandomStreamFloat(&simStream);
+}
@@ -0,0 +1,24 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include "snapshot.h"
+
+// Seeded random numbers for the simulation so runs can be reproduced,
+// GetRandomValue from raylib shares its state with the rest of the program.
+void SeedSimRandom(unsigned int seed);
+int GetSimRandomValue(int min, int max);  // Inclusive range like GetRandomValue
+float GetSimRandomFloat(void);             // [0, 1)
+StateRegion GetSimRandomStateRegion(void);  // For snapshots
+
+// Independent generator for work that must not disturb the simulation
+// sequence, such as building world chunks on another thread
+typedef struct {
+    uint64_t state;
+} RandomStream;
+
+void SeedRandomStream(RandomStream* stream, uint64_t seed);
+int GetRandomStreamValue(RandomStream* stream, int min, int max);
+float GetRandomStreamFloat(RandomStream* stream);
+
+#endif // RNG_H
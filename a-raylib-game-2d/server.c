@@ -0,0 +1,432 @@
+// Headless authoritative server for Space Collector. Runs the simulation at
+// the fixed tick rate and streams snapshots to game clients over loopback.
+// Every client flies a ship of its own, client c is player c.
+// Usage: ./server [port] [seed] [aiShips]
+//        ./server bench [clients] [ticks]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "game.h"
+#include "net.h"
+#include "snapshot.h"
+
+#define SERVER_ENCODE_CACHE 8            // Distinct baselines encoded per tick
+#define SERVER_STATUS_TICKS (SIM_TICK_RATE * 5)
+
+typedef struct {
+    bool active;
+    NetAddress address;
+    uint32_t ack;              // Newest snapshot the client has
+    uint32_t newestInput;      // Newest input received
+    uint32_t appliedInput;     // Newest input the simulation has used
+    unsigned char inputs[NET_INPUT_HISTORY];
+    unsigned int heldInput;    // Used again while the next input is late
+    bool restart;
+    int silentTicks;
+} ServerClient;
+
+// The current snapshot encoded against one baseline, shared by every
+// client that acknowledged the same one
+typedef struct {
+    uint32_t baseline;
+    size_t size;
+    unsigned char* data;
+    size_t capacity;
+} EncodedSnapshot;
+
+typedef struct {
+    long long ticks;
+    long long snapshotsSent;
+    long long bytesSent;
+    long long encodes;
+    double simNanoseconds;      // Simulation and capture
+    double networkNanoseconds;  // Receiving, encoding and sending
+} ServerStats;
+
+static int serverSocket = -1;
+static ServerClient clients[NET_MAX_CLIENTS];
+static Snapshot history[NET_SNAPSHOT_HISTORY];
+static uint32_t historySequence[NET_SNAPSHOT_HISTORY];
+static uint32_t sequence = 0;         // Ticks run, also the newest snapshot
+static EncodedSnapshot encoded[SERVER_ENCODE_CACHE];
+static int encodedCount = 0;
+static ServerStats stats = { 0 };
+static volatile sig_atomic_t running = 1;
+static bool logClients = true;        // Off while benchmarking
+
+static double GetNanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void StopServer(int signal) {
+    (void)signal;
+    running = 0;
+}
+
+static int FindClient(const NetAddress* address) {
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        if (clients[c].active && SameNetAddress(&clients[c].address, address)) return c;
+    }
+    return -1;
+}
+
+static void AddClient(const NetAddress* address) {
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        if (clients[c].active) continue;
+        clients[c] = (ServerClient){ .active = true, .address = *address };
+        AddPlayer(c);
+        if (logClients) printf("client %d connected%s\n", c, IsGameOver() ? ", waiting for the next game" : "");
+        return;
+    }
+}
+
+static void RemoveClient(int c) {
+    clients[c].active = false;
+    RemovePlayer(c);
+    if (logClients) printf("client %d left\n", c);
+}
+
+static void HandleInput(ServerClient* client, const NetInputPacket* packet) {
+    client->silentTicks = 0;
+    if (packet->ack > client->ack && packet->ack <= sequence) client->ack = packet->ack;
+    client->restart = client->restart || packet->restart;
+
+    if (packet->inputCount > NET_INPUT_REDUNDANCY) return;
+    for (int i = 0; i < packet->inputCount; i++) {
+        uint32_t input = packet->lastInput - packet->inputCount + 1 + i;
+        if (input <= client->appliedInput) continue;
+        client->inputs[input % NET_INPUT_HISTORY] = packet->inputs[i];
+        if (input > client->newestInput) client->newestInput = input;
+    }
+}
+
+static void ReceivePackets(void) {
+    unsigned char packet[sizeof(NetInputPacket)];
+    NetAddress from;
+    int size;
+    while ((size = ReceiveNetPacket(serverSocket, &from, packet, sizeof(packet))) >= 0) {
+        if (size == 0) continue;
+        int c = FindClient(&from);
+        switch (packet[0]) {
+        case NET_PACKET_CONNECT:
+            if (c < 0) AddClient(&from);
+            break;
+        case NET_PACKET_DISCONNECT:
+            if (c >= 0) RemoveClient(c);
+            break;
+        case NET_PACKET_INPUT:
+            if (c >= 0 && size == sizeof(NetInputPacket)) {
+                NetInputPacket input;
+                memcpy(&input, packet, sizeof(input));
+                HandleInput(&clients[c], &input);
+            }
+            break;
+        }
+    }
+
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        if (clients[c].active && ++clients[c].silentTicks > NET_TIMEOUT_TICKS) RemoveClient(c);
+    }
+}
+
+// A client's inputs are used in order, one per tick. A late input repeats
+// the last one, and a client that got far ahead skips to its newest inputs
+// instead of staying behind.
+static unsigned int NextClientInput(int c) {
+    ServerClient* client = &clients[c];
+    if (client->newestInput - client->appliedInput > NET_INPUT_HISTORY / 2) {
+        client->appliedInput = client->newestInput - NET_INPUT_REDUNDANCY;
+    }
+    if (client->newestInput > client->appliedInput) {
+        client->appliedInput++;
+        client->heldInput = client->inputs[client->appliedInput % NET_INPUT_HISTORY];
+    }
+    return client->heldInput;
+}
+
+static const EncodedSnapshot* EncodeForBaseline(uint32_t baseline) {
+    for (int e = 0; e < encodedCount; e++) {
+        if (encoded[e].baseline == baseline) return &encoded[e];
+    }
+
+    // Clients are rarely spread over this many baselines, the last slot is reused if so
+    EncodedSnapshot* entry = &encoded[encodedCount < SERVER_ENCODE_CACHE ? encodedCount++ : SERVER_ENCODE_CACHE - 1];
+    const Snapshot* current = &history[sequence % NET_SNAPSHOT_HISTORY];
+    size_t bound = GetSnapshotDeltaBound(current->size);
+    if (entry->capacity < bound) {
+        unsigned char* data = realloc(entry->data, bound);
+        if (data == NULL) return NULL;
+        entry->data = data;
+        entry->capacity = bound;
+    }
+
+    const unsigned char* base = baseline != 0 ? history[baseline % NET_SNAPSHOT_HISTORY].data : NULL;
+    entry->baseline = baseline;
+    entry->size = EncodeSnapshotDelta(current->data, base, current->size, entry->data);
+    stats.encodes++;
+    return entry;
+}
+
+static void SendSnapshots(void) {
+    const Snapshot* current = &history[sequence % NET_SNAPSHOT_HISTORY];
+    encodedCount = 0;
+
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        ServerClient* client = &clients[c];
+        if (!client->active) continue;
+
+        // Deltas go against what the client last acknowledged, or the
+        // whole state if that is too old to still be kept
+        uint32_t baseline = client->ack;
+        if (baseline != 0 && (sequence - baseline >= NET_SNAPSHOT_HISTORY ||
+                              historySequence[baseline % NET_SNAPSHOT_HISTORY] != baseline)) {
+            baseline = 0;
+        }
+
+        const EncodedSnapshot* delta = EncodeForBaseline(baseline);
+        if (delta == NULL) continue;
+        NetSnapshotHeader header = {
+            .player = (uint8_t)c,
+            .sequence = sequence,
+            .baseline = baseline,
+            .lastInput = client->appliedInput,
+            .stateSize = (uint32_t)current->size,
+            .encodedSize = (uint32_t)delta->size
+        };
+        stats.bytesSent += SendNetSnapshot(serverSocket, &client->address, header, delta->data);
+        stats.snapshotsSent++;
+    }
+}
+
+static void ServerTick(void) {
+    double start = GetNanoseconds();
+    ReceivePackets();
+    double simStart = GetNanoseconds();
+
+    if (IsGameOver()) {
+        // Any client may start the next game
+        bool restart = false;
+        for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+            restart = restart || (clients[c].active && clients[c].restart);
+        }
+        if (restart) ResetGame();
+    } else {
+        unsigned int inputs[MAX_PLAYERS] = { 0 };
+        for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+            if (clients[c].active) inputs[c] = NextClientInput(c);
+        }
+        SavePreviousState();
+        UpdateGamePlayers(inputs, SIM_DT);
+    }
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        clients[c].restart = false;
+    }
+
+    // The events stay in the snapshot for clients to show
+    sequence++;
+    CaptureSnapshot(&history[sequence % NET_SNAPSHOT_HISTORY]);
+    historySequence[sequence % NET_SNAPSHOT_HISTORY] = sequence;
+    ConsumeGameEvents();
+    double simEnd = GetNanoseconds();
+
+    SendSnapshots();
+    double end = GetNanoseconds();
+
+    stats.ticks++;
+    stats.simNanoseconds += simEnd - simStart;
+    stats.networkNanoseconds += (simStart - start) + (end - simEnd);
+}
+
+static bool InitServer(GameConfig config, int port) {
+    serverSocket = OpenNetSocket(port);
+    if (serverSocket < 0) return false;
+    // Nobody flies until a client connects
+    InitGame(config);
+    RemovePlayer(0);
+    return true;
+}
+
+static void UnloadServer(void) {
+    CloseNetSocket(serverSocket);
+    serverSocket = -1;
+    for (int s = 0; s < NET_SNAPSHOT_HISTORY; s++) {
+        UnloadSnapshot(&history[s]);
+        historySequence[s] = 0;
+    }
+    for (int e = 0; e < SERVER_ENCODE_CACHE; e++) {
+        free(encoded[e].data);
+        encoded[e] = (EncodedSnapshot){ 0 };
+    }
+    memset(clients, 0, sizeof(clients));
+    sequence = 0;
+    UnloadGame();
+}
+
+static int CountClients(void) {
+    int count = 0;
+    for (int c = 0; c < NET_MAX_CLIENTS; c++) {
+        if (clients[c].active) count++;
+    }
+    return count;
+}
+
+// Scripted player for the benchmark: turns every half second, always
+// firing. Each client starts the circle at a different point.
+static unsigned int ScriptedInput(int client, long long tick) {
+    static const unsigned int directions[] = {
+        INPUT_UP, INPUT_UP | INPUT_RIGHT, INPUT_RIGHT, INPUT_DOWN | INPUT_RIGHT,
+        INPUT_DOWN, INPUT_DOWN | INPUT_LEFT, INPUT_LEFT, INPUT_UP | INPUT_LEFT
+    };
+    return directions[(tick / (SIM_TICK_RATE / 2) + client) % 8] | INPUT_FIRE;
+}
+
+// Connects clients over loopback, each flying its own ship, and runs a
+// fresh server as fast as it goes. Clients only drain their sockets and
+// send their input. Client c acknowledges every 1 + c % 4 ticks, so the
+// snapshots go out against several baselines as they would with clients
+// at different distances. The timings are the server's alone.
+static bool MeasureClients(int clientCount, long long ticks, ServerStats* result, size_t* snapshotSize) {
+    if (!InitServer(GetDefaultGameConfig(), 0)) {
+        fprintf(stderr, "Could not open the server socket\n");
+        return false;
+    }
+
+    NetAddress server = GetLoopbackAddress(GetNetSocketPort(serverSocket));
+    int sockets[NET_MAX_CLIENTS];
+    uint32_t received[NET_MAX_CLIENTS] = { 0 };
+    uint32_t acks[NET_MAX_CLIENTS] = { 0 };
+    bool connected = true;
+    for (int c = 0; c < clientCount; c++) {
+        sockets[c] = OpenNetSocket(0);
+        uint8_t type = NET_PACKET_CONNECT;
+        if (sockets[c] < 0 || !SendNetPacket(sockets[c], &server, &type, sizeof(type))) {
+            fprintf(stderr, "Could not connect client %d\n", c);
+            clientCount = c + (sockets[c] >= 0);
+            connected = false;
+            break;
+        }
+    }
+    if (connected) {
+        ServerTick();
+        stats = (ServerStats){ 0 };
+    }
+
+    unsigned char packet[sizeof(NetSnapshotHeader) + NET_FRAGMENT_SIZE];
+    unsigned char scripted[NET_MAX_CLIENTS][NET_INPUT_HISTORY];
+    for (long long t = 0; t < ticks && connected; t++) {
+        for (int c = 0; c < clientCount; c++) {
+            NetAddress from;
+            while (ReceiveNetPacket(sockets[c], &from, packet, sizeof(packet)) >= (int)sizeof(NetSnapshotHeader)) {
+                NetSnapshotHeader header;
+                memcpy(&header, packet, sizeof(header));
+                if (header.fragment + 1 == header.fragmentCount && header.sequence > received[c]) {
+                    received[c] = header.sequence;
+                }
+            }
+            if (t % (1 + c % 4) == 0) acks[c] = received[c];
+
+            uint32_t last = (uint32_t)t + 1;
+            scripted[c][last % NET_INPUT_HISTORY] = (unsigned char)ScriptedInput(c, t);
+            NetInputPacket input = {
+                .type = NET_PACKET_INPUT,
+                .ack = acks[c],
+                .restart = IsGameOver(),
+                .lastInput = last,
+                .inputCount = (uint16_t)(last < NET_INPUT_REDUNDANCY ? last : NET_INPUT_REDUNDANCY)
+            };
+            for (int i = 0; i < input.inputCount; i++) {
+                input.inputs[i] = scripted[c][(last - input.inputCount + 1 + i) % NET_INPUT_HISTORY];
+            }
+            SendNetPacket(sockets[c], &server, &input, sizeof(input));
+        }
+        ServerTick();
+    }
+
+    *result = stats;
+    *snapshotSize = history[sequence % NET_SNAPSHOT_HISTORY].size;
+    for (int c = 0; c < clientCount; c++) {
+        CloseNetSocket(sockets[c]);
+    }
+    UnloadServer();
+    return connected;
+}
+
+// Measures 1, 2, 4 and so on clients up to maxClients and reports the most
+// that fit in the tick budget. Nothing is extrapolated past what was run.
+static int RunBenchmark(int maxClients, long long ticks) {
+    if (maxClients < 1) maxClients = 1;
+    if (maxClients > NET_MAX_CLIENTS) maxClients = NET_MAX_CLIENTS;
+    double budget = SIM_DT * 1e9;
+    int fit = 0;
+    logClients = false;
+
+    printf("%lld ticks per run (%d Hz), %.1f ms tick budget\n", ticks, SIM_TICK_RATE, budget / 1e6);
+    printf("clients  snapshot  bytes/client/tick  encodes/tick  us/tick sim  network  total\n");
+    // The last run is always the count asked for
+    for (int clientCount = 1; ; clientCount = clientCount * 2 < maxClients ? clientCount * 2 : maxClients) {
+        ServerStats run;
+        size_t snapshotSize;
+        if (!MeasureClients(clientCount, ticks, &run, &snapshotSize)) return 1;
+
+        double tickCount = run.ticks > 0 ? (double)run.ticks : 1.0;
+        double simPerTick = run.simNanoseconds / tickCount;
+        double networkPerTick = run.networkNanoseconds / tickCount;
+        printf("%7d  %8zu  %17.0f  %12.2f  %11.1f  %7.1f  %5.1f\n", clientCount, snapshotSize,
+            run.bytesSent / tickCount / clientCount, run.encodes / tickCount,
+            simPerTick / 1000, networkPerTick / 1000, (simPerTick + networkPerTick) / 1000);
+        if (simPerTick + networkPerTick <= budget) fit = clientCount;
+        if (clientCount == maxClients) break;
+    }
+
+    printf("clients per tick:  %d, the most measured that fit in the tick budget\n", fit);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return RunBenchmark(argc > 2 ? atoi(argv[2]) : NET_MAX_CLIENTS, argc > 3 ? atoll(argv[3]) : 3000);
+    }
+
+    GameConfig config = GetDefaultGameConfig();
+    config.seed = (unsigned int)time(NULL);
+    int port = argc > 1 ? atoi(argv[1]) : NET_DEFAULT_PORT;
+    if (argc > 2) config.seed = (unsigned int)strtoul(argv[2], NULL, 10);
+    if (argc > 3) config.aiShipCount = atoi(argv[3]);
+
+    if (!InitServer(config, port)) {
+        fprintf(stderr, "Could not open UDP port %d\n", port);
+        return 1;
+    }
+    signal(SIGINT, StopServer);
+    signal(SIGTERM, StopServer);
+    printf("Space Collector server on 127.0.0.1:%d, seed %u\n", port, config.seed);
+
+    // Fixed ticks on the wall clock, skipping ahead if the process was stalled
+    double next = GetNanoseconds();
+    while (running) {
+        ServerTick();
+
+        if (stats.ticks % SERVER_STATUS_TICKS == 0) {
+            printf("tick %u: %d clients, %.0f bytes/snapshot, %.1f us/tick\n",
+                sequence, CountClients(),
+                stats.snapshotsSent > 0 ? (double)stats.bytesSent / stats.snapshotsSent : 0.0,
+                (stats.simNanoseconds + stats.networkNanoseconds) / stats.ticks / 1000);
+            stats = (ServerStats){ 0 };
+        }
+
+        next += SIM_DT * 1e9;
+        double now = GetNanoseconds();
+        if (now - next > 1e9) next = now;
+        if (next > now) {
+            struct timespec wait = { (time_t)((next - now) / 1e9), (long)((long long)(next - now) % 1000000000LL) };
+            nanosleep(&wait, NULL);
+        }
+    }
+
+    UnloadServer();
+    return 0;
+}
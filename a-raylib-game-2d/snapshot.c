@@ -0,0 +1,157 @@
+#include "snapshot.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "game.h"
+
+// Followed by the size of every region and then the regions themselves
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t regionCount;
+    uint32_t seed;
+    int32_t coinsPerChunk;
+    int32_t asteroidsPerChunk;
+    int32_t aiShipCount;
+    uint64_t payloadSize;
+} SnapshotHeader;
+
+static size_t GetPayloadSize(const StateRegion* regions, int count) {
+    size_t size = 0;
+    for (int r = 0; r < count; r++) {
+        size += regions[r].size;
+    }
+    return size;
+}
+
+bool CaptureSnapshot(Snapshot* snapshot) {
+    StateRegion regions[MAX_STATE_REGIONS];
+    int count = GetGameStateRegions(regions, MAX_STATE_REGIONS);
+    if (count < 0) return false;
+
+    size_t payloadSize = GetPayloadSize(regions, count);
+    size_t size = sizeof(SnapshotHeader) + count * sizeof(uint64_t) + payloadSize;
+    if (size > snapshot->capacity) {
+        unsigned char* data = realloc(snapshot->data, size);
+        if (data == NULL) return false;
+        snapshot->data = data;
+        snapshot->capacity = size;
+    }
+
+    GameConfig config = GetGameConfig();
+    SnapshotHeader header = {
+        .version = SNAPSHOT_VERSION,
+        .regionCount = (uint16_t)count,
+        .seed = config.seed,
+        .coinsPerChunk = config.coinsPerChunk,
+        .asteroidsPerChunk = config.asteroidsPerChunk,
+        .aiShipCount = config.aiShipCount,
+        .payloadSize = payloadSize
+    };
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+
+    unsigned char* out = snapshot->data;
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (int r = 0; r < count; r++) {
+        uint64_t regionSize = regions[r].size;
+        memcpy(out, &regionSize, sizeof(regionSize));
+        out += sizeof(regionSize);
+    }
+    for (int r = 0; r < count; r++) {
+        memcpy(out, regions[r].data, regions[r].size);
+        out += regions[r].size;
+    }
+
+    snapshot->size = size;
+    return true;
+}
+
+// Checks everything before touching the simulation, so a bad file leaves it alone
+static bool RestoreSnapshotData(const unsigned char* data, size_t size) {
+    SnapshotHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, 4) != 0 || header.version != SNAPSHOT_VERSION) return false;
+
+    StateRegion regions[MAX_STATE_REGIONS];
+    int count = GetGameStateRegions(regions, MAX_STATE_REGIONS);
+    if (count < 0 || header.regionCount != count) return false;
+
+    size_t payloadSize = GetPayloadSize(regions, count);
+    if (header.payloadSize != payloadSize ||
+        size != sizeof(header) + count * sizeof(uint64_t) + payloadSize) return false;
+
+    const unsigned char* in = data + sizeof(header);
+    for (int r = 0; r < count; r++) {
+        uint64_t regionSize;
+        memcpy(&regionSize, in, sizeof(regionSize));
+        in += sizeof(regionSize);
+        if (regionSize != regions[r].size) return false;
+    }
+
+    // Another world needs the world stream and the AI set up for it first
+    GameConfig config = GetGameConfig();
+    if (config.seed != header.seed || config.coinsPerChunk != header.coinsPerChunk ||
+        config.asteroidsPerChunk != header.asteroidsPerChunk || config.aiShipCount != header.aiShipCount) {
+        config.seed = header.seed;
+        config.coinsPerChunk = header.coinsPerChunk;
+        config.asteroidsPerChunk = header.asteroidsPerChunk;
+        config.aiShipCount = header.aiShipCount;
+        InitGame(config);
+    }
+
+    for (int r = 0; r < count; r++) {
+        memcpy(regions[r].data, in, regions[r].size);
+        in += regions[r].size;
+    }
+    RestoreGameState();
+    return true;
+}
+
+bool RestoreSnapshot(const Snapshot* snapshot) {
+    return snapshot->data != NULL && RestoreSnapshotData(snapshot->data, snapshot->size);
+}
+
+bool SaveSnapshot(const Snapshot* snapshot, const char* path) {
+    int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return false;
+
+    // One write for the whole thing, only repeated if the kernel takes less
+    size_t written = 0;
+    while (written < snapshot->size) {
+        ssize_t result = write(file, snapshot->data + written, snapshot->size - written);
+        if (result <= 0) break;
+        written += (size_t)result;
+    }
+    return close(file) == 0 && written == snapshot->size;
+}
+
+bool LoadSnapshot(const char* path) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size <= 0) {
+        close(file);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) return false;
+
+    bool restored = RestoreSnapshotData(data, size);
+    munmap(data, size);
+    return restored;
+}
+
+void UnloadSnapshot(Snapshot* snapshot) {
+    free(snapshot->data);
+    *snapshot = (Snapshot){ 0 };
+}
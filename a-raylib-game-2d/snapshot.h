@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Snapshots of the whole simulation state. Every module hands out the
+// memory its state lives in as regions, and a snapshot is those regions
+// copied back to back behind a small header. Capturing is a handful of
+// memcpy calls and saving is a single write, so a snapshot can be taken
+// every frame to rewind while debugging.
+//
+// The payload is raw memory, so files only load into the same build on the
+// same kind of machine. The version and the size of every region are
+// checked, anything else is refused. Use replays to share a session.
+#define SNAPSHOT_MAGIC "SCSN"
+#define SNAPSHOT_VERSION 1
+#define MAX_STATE_REGIONS 32
+
+// A piece of simulation state that is saved as is
+typedef struct {
+    void* data;
+    size_t size;
+} StateRegion;
+
+typedef struct {
+    unsigned char* data;  // Exactly what goes to disk
+    size_t size;
+    size_t capacity;      // Grows on the first capture and then stays
+} Snapshot;
+
+bool CaptureSnapshot(Snapshot* snapshot);
+// Puts the simulation back, restarting it first if the snapshot was taken
+// with another seed or other world settings
+bool RestoreSnapshot(const Snapshot* snapshot);
+bool SaveSnapshot(const Snapshot* snapshot, const char* path);
+// Maps the file and restores the simulation straight from it
+bool LoadSnapshot(const char* path);
+void UnloadSnapshot(Snapshot* snapshot);
+
+#endif // SNAPSHOT_H
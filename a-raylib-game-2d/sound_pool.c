@@ -0,0 +1,122 @@
+#include "sound_pool.h"
+#include "raymath.h"
+#include <stddef.h>
+
+typedef struct {
+    bool playing;
+    Sound alias;          // Plays the samples of source without copying them
+    const void* source;   // Audio buffer of the sound the alias was made from
+    Vector2 position;
+    float volume;         // Before attenuation
+    float gain;           // After attenuation, what the voice is mixed at
+    SoundPriority priority;
+} SoundVoice;
+
+static SoundVoice voices[MAX_SOUND_VOICES];
+static Vector2 listenerPosition = { 0 };
+
+// Distance falloff, smooth so sounds fade out instead of cutting off
+static float GetAttenuation(Vector2 position) {
+    float distance = Vector2Distance(position, listenerPosition);
+    float t = (distance - SOUND_FULL_DISTANCE) / (SOUND_MAX_DISTANCE - SOUND_FULL_DISTANCE);
+    t = Clamp(t, 0.0f, 1.0f);
+    return (1.0f - t) * (1.0f - t);
+}
+
+// 0.5 is centered, sounds left of the listener go toward 0
+static float GetPan(Vector2 position) {
+    float offset = (position.x - listenerPosition.x) / SOUND_PAN_DISTANCE;
+    return 0.5f + Clamp(offset, -1.0f, 1.0f) * 0.5f;
+}
+
+static void ApplyVoice(SoundVoice* voice) {
+    voice->gain = voice->volume * GetAttenuation(voice->position);
+    SetSoundVolume(voice->alias, voice->gain);
+    SetSoundPan(voice->alias, GetPan(voice->position));
+}
+
+static void StopVoice(SoundVoice* voice) {
+    if (voice->playing) StopSound(voice->alias);
+    voice->playing = false;
+}
+
+void InitSoundPool(void) {
+    UnloadSoundPool();
+}
+
+void UnloadSoundPool(void) {
+    for (int v = 0; v < MAX_SOUND_VOICES; v++) {
+        StopVoice(&voices[v]);
+        if (voices[v].source != NULL) UnloadSoundAlias(voices[v].alias);
+        voices[v] = (SoundVoice){ 0 };
+    }
+}
+
+// A free voice, or the one the new sound may cut off, -1 if none
+static int FindVoice(float gain, SoundPriority priority) {
+    int victim = -1;
+    for (int v = 0; v < MAX_SOUND_VOICES; v++) {
+        if (!voices[v].playing) return v;
+
+        const SoundVoice* voice = &voices[v];
+        if (voice->priority > priority) continue;
+        if (victim < 0 || voice->priority < voices[victim].priority ||
+            (voice->priority == voices[victim].priority && voice->gain < voices[victim].gain)) {
+            victim = v;
+        }
+    }
+
+    // Never drop a louder sound of the same priority for a quieter one
+    if (victim >= 0 && voices[victim].priority == priority && voices[victim].gain >= gain) return -1;
+    return victim;
+}
+
+bool PlaySoundAt(Sound sound, Vector2 position, float volume, SoundPriority priority) {
+    if (sound.stream.buffer == NULL) return false;
+
+    float gain = volume * GetAttenuation(position);
+    if (gain < SOUND_MIN_GAIN) return false;
+
+    int v = FindVoice(gain, priority);
+    if (v < 0) return false;
+
+    SoundVoice* voice = &voices[v];
+    StopVoice(voice);
+
+    // Aliases are kept per voice and only remade when the voice changes sound
+    if (voice->source != sound.stream.buffer) {
+        if (voice->source != NULL) UnloadSoundAlias(voice->alias);
+        voice->alias = LoadSoundAlias(sound);
+        voice->source = sound.stream.buffer;
+    }
+
+    voice->position = position;
+    voice->volume = volume;
+    voice->priority = priority;
+    ApplyVoice(voice);
+    PlaySound(voice->alias);
+    voice->playing = true;
+    return true;
+}
+
+void UpdateSoundPool(Vector2 listener) {
+    listenerPosition = listener;
+    for (int v = 0; v < MAX_SOUND_VOICES; v++) {
+        SoundVoice* voice = &voices[v];
+        if (!voice->playing) continue;
+
+        if (!IsSoundPlaying(voice->alias)) {
+            voice->playing = false;
+        } else {
+            ApplyVoice(voice);
+        }
+    }
+}
+
+int GetSoundVoiceCount(void) {
+    int count = 0;
+    for (int v = 0; v < MAX_SOUND_VOICES; v++) {
+        if (voices[v].playing) count++;
+    }
+    return count;
+}
@@ -0,0 +1,34 @@
+#ifndef SOUND_POOL_H
+#define SOUND_POOL_H
+
+#include "raylib.h"
+
+// Positional one-shot sounds. A fixed set of voices plays aliases of the
+// loaded sounds, so the same sound can overlap itself, and no more than
+// MAX_SOUND_VOICES are ever mixed at once. Volume falls off with distance
+// from the listener and sounds pan toward the side they came from. When
+// every voice is busy a new sound takes the quietest voice of lower or
+// equal priority, or is dropped if there is none.
+
+#define MAX_SOUND_VOICES 16
+#define SOUND_FULL_DISTANCE 200.0f  // Full volume up to here
+#define SOUND_MAX_DISTANCE 900.0f   // Silent from here on, such sounds never take a voice
+#define SOUND_PAN_DISTANCE 600.0f   // Horizontal offset panned fully to one side
+#define SOUND_MIN_GAIN 0.01f
+
+typedef enum {
+    SOUND_PRIORITY_LOW,
+    SOUND_PRIORITY_NORMAL,
+    SOUND_PRIORITY_HIGH
+} SoundPriority;
+
+void InitSoundPool(void);
+void UnloadSoundPool(void);
+
+// Starts sound at a world position, returns false if it was not played
+bool PlaySoundAt(Sound sound, Vector2 position, float volume, SoundPriority priority);
+// Frees finished voices and follows the listener, call once a frame
+void UpdateSoundPool(Vector2 listener);
+int GetSoundVoiceCount(void);  // Voices playing right now
+
+#endif // SOUND_POOL_H
@@ -0,0 +1,245 @@
+#include "spatial_hash.h"
+#include <stdlib.h>
+#include <math.h>
+#include "game_defs.h"
+
+static bool spatialHashEnabled = true;
+
+static int HashCell(int cellX, int cellY) {
+    unsigned int h = ((unsigned int)cellX * 73856093u) ^ ((unsigned int)cellY * 19349663u);
+    return (int)(h & (SPATIAL_HASH_BUCKETS - 1));
+}
+
+static int CellCoord(const SpatialHash* hash, float value) {
+    return (int)floorf(value / hash->cellSize);
+}
+
+void InitSpatialHash(SpatialHash* hash, float cellSize, int capacity) {
+    hash->cellSize = cellSize;
+    hash->maxRadius = 0.0f;
+    hash->count = 0;
+    hash->capacity = capacity;
+    hash->entries = malloc(sizeof(SpatialHashEntry) * capacity);
+    hash->buckets = malloc(sizeof(int) * SPATIAL_HASH_BUCKETS);
+    for (int i = 0; i < SPATIAL_HASH_BUCKETS; i++) {
+        hash->buckets[i] = -1;
+    }
+}
+
+void UnloadSpatialHash(SpatialHash* hash) {
+    free(hash->entries);
+    free(hash->buckets);
+    hash->entries = NULL;
+    hash->buckets = NULL;
+    hash->count = 0;
+    hash->capacity = 0;
+}
+
+void ClearSpatialHash(SpatialHash* hash) {
+    // Only touch the buckets that were used instead of wiping the whole table
+    for (int i = 0; i < hash->count; i++) {
+        hash->buckets[HashCell(hash->entries[i].cellX, hash->entries[i].cellY)] = -1;
+    }
+    hash->count = 0;
+    hash->maxRadius = 0.0f;
+}
+
+void InsertSpatialHash(SpatialHash* hash, int id, Vector2 position, float radius) {
+    if (hash->count >= hash->capacity) return;
+
+    SpatialHashEntry* entry = &hash->entries[hash->count];
+    entry->id = id;
+    entry->cellX = CellCoord(hash, position.x);
+    entry->cellY = CellCoord(hash, position.y);
+    entry->position = position;
+    entry->radius = radius;
+
+    int bucket = HashCell(entry->cellX, entry->cellY);
+    entry->next = hash->buckets[bucket];
+    hash->buckets[bucket] = hash->count;
+    hash->count++;
+
+    if (radius > hash->maxRadius) hash->maxRadius = radius;
+}
+
+static bool EntryOverlaps(const SpatialHashEntry* entry, Vector2 center, float radius) {
+    float dx = entry->position.x - center.x;
+    float dy = entry->position.y - center.y;
+    float reach = entry->radius + radius;
+    return dx*dx + dy*dy <= reach*reach;
+}
+
+// Keeps the lowest ids in ascending order, dropping the highest when full,
+// so the results do not depend on the order entries were visited in
+static int AddQueryResult(int* results, int found, int maxResults, int id) {
+    if (found == maxResults && id >= results[found - 1]) return found;
+    int i = found < maxResults ? found++ : found - 1;
+    for (; i > 0 && results[i - 1] > id; i--) {
+        results[i] = results[i - 1];
+    }
+    results[i] = id;
+    return found;
+}
+
+int QuerySpatialHash(const SpatialHash* hash, Vector2 center, float radius, int* results, int maxResults) {
+    int found = 0;
+    if (maxResults <= 0) return 0;
+
+    if (!spatialHashEnabled) {
+        for (int i = 0; i < hash->count; i++) {
+            if (EntryOverlaps(&hash->entries[i], center, radius)) {
+                found = AddQueryResult(results, found, maxResults, hash->entries[i].id);
+            }
+        }
+        return found;
+    }
+
+    float reach = radius + hash->maxRadius;
+    int minX = CellCoord(hash, center.x - reach);
+    int maxX = CellCoord(hash, center.x + reach);
+    int minY = CellCoord(hash, center.y - reach);
+    int maxY = CellCoord(hash, center.y + reach);
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            for (int e = hash->buckets[HashCell(cx, cy)]; e != -1; e = hash->entries[e].next) {
+                const SpatialHashEntry* entry = &hash->entries[e];
+                // Different cells can share a bucket, skip those to avoid duplicates
+                if (entry->cellX != cx || entry->cellY != cy) continue;
+                if (!EntryOverlaps(entry, center, radius)) continue;
+
+                found = AddQueryResult(results, found, maxResults, entry->id);
+            }
+        }
+    }
+
+    return found;
+}
+
+// How far along from + move * t the circle first touches the entry, or -1
+// if it never does within [0, 1]
+static float EntrySweepTime(const SpatialHashEntry* entry, Vector2 from, Vector2 move, float radius) {
+    float fx = from.x - entry->position.x;
+    float fy = from.y - entry->position.y;
+    float reach = entry->radius + radius;
+    float c = fx*fx + fy*fy - reach*reach;
+    if (c <= 0.0f) return 0.0f;
+
+    float a = move.x*move.x + move.y*move.y;
+    float b = fx*move.x + fy*move.y;
+    if (a <= 0.0f || b >= 0.0f) return -1.0f;
+
+    float discriminant = b*b - a*c;
+    if (discriminant < 0.0f) return -1.0f;
+    float t = (-b - sqrtf(discriminant)) / a;
+    return t <= 1.0f ? t : -1.0f;
+}
+
+// Hits at the same time are ordered by id, so which ones are kept does not
+// depend on the order the cells were walked in
+static bool SweepHitBefore(int id, float t, int otherId, float otherT) {
+    return t < otherT || (t == otherT && id < otherId);
+}
+
+// Keeps the nearest hits sorted by time, dropping the farthest when full
+static int AddSweepHit(int* results, float* times, int found, int maxResults, int id, float t) {
+    if (found == maxResults && !SweepHitBefore(id, t, results[found - 1], times[found - 1])) return found;
+    int i = found < maxResults ? found++ : found - 1;
+    for (; i > 0 && SweepHitBefore(id, t, results[i - 1], times[i - 1]); i--) {
+        results[i] = results[i - 1];
+        times[i] = times[i - 1];
+    }
+    results[i] = id;
+    times[i] = t;
+    return found;
+}
+
+int QuerySpatialHashSweep(const SpatialHash* hash, Vector2 from, Vector2 to, float radius,
+                          int* results, float* times, int maxResults) {
+    float hitTimes[SPATIAL_HASH_MAX_SWEEP_RESULTS];
+    if (maxResults > SPATIAL_HASH_MAX_SWEEP_RESULTS) maxResults = SPATIAL_HASH_MAX_SWEEP_RESULTS;
+    if (maxResults <= 0) return 0;
+
+    Vector2 move = { to.x - from.x, to.y - from.y };
+    int found = 0;
+
+    if (!spatialHashEnabled) {
+        for (int i = 0; i < hash->count; i++) {
+            float t = EntrySweepTime(&hash->entries[i], from, move, radius);
+            if (t >= 0.0f) found = AddSweepHit(results, hitTimes, found, maxResults, hash->entries[i].id, t);
+        }
+    } else {
+        // Every cell the swept circle's bounding box reaches, moves are short
+        // next to the cell size so this stays a handful of cells
+        float reach = radius + hash->maxRadius;
+        int minX = CellCoord(hash, fminf(from.x, to.x) - reach);
+        int maxX = CellCoord(hash, fmaxf(from.x, to.x) + reach);
+        int minY = CellCoord(hash, fminf(from.y, to.y) - reach);
+        int maxY = CellCoord(hash, fmaxf(from.y, to.y) + reach);
+
+        for (int cy = minY; cy <= maxY; cy++) {
+            for (int cx = minX; cx <= maxX; cx++) {
+                for (int e = hash->buckets[HashCell(cx, cy)]; e != -1; e = hash->entries[e].next) {
+                    const SpatialHashEntry* entry = &hash->entries[e];
+                    if (entry->cellX != cx || entry->cellY != cy) continue;
+
+                    float t = EntrySweepTime(entry, from, move, radius);
+                    if (t >= 0.0f) found = AddSweepHit(results, hitTimes, found, maxResults, entry->id, t);
+                }
+            }
+        }
+    }
+
+    if (times != NULL) {
+        for (int i = 0; i < found; i++) times[i] = hitTimes[i];
+    }
+    return found;
+}
+
+static bool EntryOverlapsRect(const SpatialHashEntry* entry, Rectangle rect) {
+    return entry->position.x + entry->radius >= rect.x &&
+           entry->position.x - entry->radius <= rect.x + rect.width &&
+           entry->position.y + entry->radius >= rect.y &&
+           entry->position.y - entry->radius <= rect.y + rect.height;
+}
+
+int QuerySpatialHashRect(const SpatialHash* hash, Rectangle rect, int* results, int maxResults) {
+    int found = 0;
+
+    if (!spatialHashEnabled) {
+        for (int i = 0; i < hash->count && found < maxResults; i++) {
+            if (EntryOverlapsRect(&hash->entries[i], rect)) {
+                results[found++] = hash->entries[i].id;
+            }
+        }
+        return found;
+    }
+
+    int minX = CellCoord(hash, rect.x - hash->maxRadius);
+    int maxX = CellCoord(hash, rect.x + rect.width + hash->maxRadius);
+    int minY = CellCoord(hash, rect.y - hash->maxRadius);
+    int maxY = CellCoord(hash, rect.y + rect.height + hash->maxRadius);
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            for (int e = hash->buckets[HashCell(cx, cy)]; e != -1; e = hash->entries[e].next) {
+                const SpatialHashEntry* entry = &hash->entries[e];
+                if (entry->cellX != cx || entry->cellY != cy) continue;
+                if (!EntryOverlapsRect(entry, rect)) continue;
+
+                results[found++] = entry->id;
+                if (found >= maxResults) return found;
+            }
+        }
+    }
+
+    return found;
+}
+
+void SetSpatialHashEnabled(bool enabled) {
+    spatialHashEnabled = enabled;
+}
+
+bool IsSpatialHashEnabled(void) {
+    return spatialHashEnabled;
+}
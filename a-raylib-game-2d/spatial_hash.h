@@ -0,0 +1,49 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "raylib.h"
+
+#define SPATIAL_HASH_MAX_SWEEP_RESULTS 16
+
+// Uniform grid broad phase. Every entry lives in the cell containing its
+// center; queries widen their search by the largest radius inserted so far.
+typedef struct {
+    int id;
+    int cellX;
+    int cellY;
+    Vector2 position;
+    float radius;
+    int next;
+} SpatialHashEntry;
+
+typedef struct {
+    float cellSize;
+    float maxRadius;
+    int* buckets;
+    SpatialHashEntry* entries;
+    int count;
+    int capacity;
+} SpatialHash;
+
+void InitSpatialHash(SpatialHash* hash, float cellSize, int capacity);
+void UnloadSpatialHash(SpatialHash* hash);
+void ClearSpatialHash(SpatialHash* hash);
+void InsertSpatialHash(SpatialHash* hash, int id, Vector2 position, float radius);
+// Finds entries overlapping the circle, by ascending id. When there are
+// more than maxResults the lowest ids are kept, so the grid and the brute
+// force scan always agree.
+int QuerySpatialHash(const SpatialHash* hash, Vector2 center, float radius, int* results, int maxResults);
+// Finds entries a circle of radius touches while moving from one point to
+// another, nearest to the start first. times gets how far along the move
+// each one was first touched, from 0 to 1, and may be NULL. At most
+// SPATIAL_HASH_MAX_SWEEP_RESULTS are returned.
+int QuerySpatialHashSweep(const SpatialHash* hash, Vector2 from, Vector2 to, float radius,
+                          int* results, float* times, int maxResults);
+// Finds entries whose bounding box overlaps rect, used for view culling
+int QuerySpatialHashRect(const SpatialHash* hash, Rectangle rect, int* results, int maxResults);
+
+// Switch between grid queries and the old brute force scan for comparison
+void SetSpatialHashEnabled(bool enabled);
+bool IsSpatialHashEnabled(void);
+
+#endif // SPATIAL_HASH_H
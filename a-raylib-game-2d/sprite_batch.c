@@ -0,0 +1,291 @@
+#include "sprite_batch.h"
+#include "rlgl.h"
+#include "assets.h"
+#include <stddef.h>
+#include <math.h>
+
+typedef struct {
+    Vector2 position;
+    Vector2 size;
+    float rotation;
+    Color tint;
+    unsigned char sprite;
+    unsigned char layer;
+} SpriteQuad;
+
+typedef struct {
+    Texture2D texture;
+    Rectangle regions[SPRITE_COUNT];  // Pixel rectangles inside the atlas
+} SpriteAtlas;
+
+static const char* spritePaths[SPRITE_COUNT] = {
+    [SPRITE_SHIP] = "assets/ship/ship.png",
+    [SPRITE_GOLD] = "assets/gold/gold.png",
+    [SPRITE_ASTEROID] = "assets/asteroids/asteroid-pixel-1.png",
+    [SPRITE_JET] = "assets/effects/jet.png",
+    [SPRITE_BEAM] = "assets/effects/beam.png",
+    [SPRITE_STATION] = "assets/stations/station1.png",
+    [SPRITE_AI_SHIP] = "assets/ship/enemy.png",
+};
+
+static SpriteAtlas atlas = { 0 };
+static AssetHandle spriteAssets[SPRITE_COUNT];  // Images being loaded for the atlas
+static SpriteQuad quads[SPRITE_BATCH_CAPACITY];
+static int quadOrder[SPRITE_BATCH_CAPACITY];
+static int quadCount = 0;
+static int lastSpriteCount = 0;
+static int flushCount = 0;
+static int lastFlushCount = 0;
+
+// Copies the image for a sprite out of the asset cache, scaled so its
+// longest side fits in a cell
+static Image LoadSpriteImage(SpriteId sprite) {
+    Image image;
+
+    if (sprite == SPRITE_WHITE) {
+        image = GenImageColor(4, 4, WHITE);
+    } else if (sprite == SPRITE_CIRCLE) {
+        image = GenImageColor(32, 32, BLANK);
+        ImageDrawCircle(&image, 16, 16, 15, WHITE);
+    } else {
+        Image cached = GetAssetImage(spriteAssets[sprite]);
+        if (!IsImageReady(cached)) return cached;
+        image = ImageCopy(cached);
+    }
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    int longest = image.width > image.height ? image.width : image.height;
+    if (longest > ATLAS_MAX_SPRITE_SIZE) {
+        float scale = (float)ATLAS_MAX_SPRITE_SIZE / longest;
+        ImageResize(&image, image.width * scale, image.height * scale);
+    }
+
+    return image;
+}
+
+void RequestSpriteAtlas(void) {
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        if (spritePaths[i] != NULL && spriteAssets[i] == ASSET_NONE) {
+            spriteAssets[i] = RequestAsset(ASSET_IMAGE, spritePaths[i]);
+        }
+    }
+}
+
+// The cached images are only needed until they are packed
+static void ReleaseSpriteImages(void) {
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        ReleaseAsset(spriteAssets[i]);
+        spriteAssets[i] = ASSET_NONE;
+    }
+}
+
+bool LoadSpriteAtlas(void) {
+    Image images[SPRITE_COUNT];
+    int order[SPRITE_COUNT];
+
+    RequestSpriteAtlas();
+    WaitForAssets();
+
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        images[i] = LoadSpriteImage(i);
+        if (!IsImageReady(images[i])) {
+            TraceLog(LOG_WARNING, "ATLAS: Failed to load sprite %d", i);
+            for (int j = 0; j < i; j++) UnloadImage(images[j]);
+            ReleaseSpriteImages();
+            return false;
+        }
+        order[i] = i;
+    }
+    ReleaseSpriteImages();
+
+    // Shelf packing works best tallest first
+    for (int i = 1; i < SPRITE_COUNT; i++) {
+        int sprite = order[i];
+        int j = i;
+        while (j > 0 && images[order[j - 1]].height < images[sprite].height) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = sprite;
+    }
+
+    int shelfX = ATLAS_PADDING;
+    int shelfY = ATLAS_PADDING;
+    int shelfHeight = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        Image* image = &images[order[i]];
+        if (shelfX + image->width + ATLAS_PADDING > ATLAS_WIDTH) {
+            shelfX = ATLAS_PADDING;
+            shelfY += shelfHeight + ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+        atlas.regions[order[i]] = (Rectangle){ shelfX, shelfY, image->width, image->height };
+        shelfX += image->width + ATLAS_PADDING;
+        if (image->height > shelfHeight) shelfHeight = image->height;
+    }
+
+    int atlasHeight = 1;
+    while (atlasHeight < shelfY + shelfHeight + ATLAS_PADDING) atlasHeight *= 2;
+
+    Image atlasImage = GenImageColor(ATLAS_WIDTH, atlasHeight, BLANK);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        Rectangle source = { 0, 0, images[i].width, images[i].height };
+        ImageDraw(&atlasImage, images[i], source, atlas.regions[i], WHITE);
+        UnloadImage(images[i]);
+    }
+
+    // Sample the middle of the solid block so filtering never reaches the edge
+    atlas.regions[SPRITE_WHITE].x += 1;
+    atlas.regions[SPRITE_WHITE].y += 1;
+    atlas.regions[SPRITE_WHITE].width -= 2;
+    atlas.regions[SPRITE_WHITE].height -= 2;
+
+    atlas.texture = LoadTextureFromImage(atlasImage);
+    UnloadImage(atlasImage);
+
+    TraceLog(LOG_INFO, "ATLAS: Packed %d sprites into %dx%d", SPRITE_COUNT, ATLAS_WIDTH, atlasHeight);
+    return true;
+}
+
+void UnloadSpriteAtlas(void) {
+    UnloadTexture(atlas.texture);
+    atlas = (SpriteAtlas){ 0 };
+}
+
+void BeginSpriteBatch(void) {
+    quadCount = 0;
+    lastSpriteCount = 0;
+    flushCount = 0;
+}
+
+// Writes one quad into the rlgl vertex stream, the atlas must be bound
+static void EmitQuad(const SpriteQuad* quad) {
+    Rectangle region = atlas.regions[quad->sprite];
+    float u0 = region.x / atlas.texture.width;
+    float v0 = region.y / atlas.texture.height;
+    float u1 = (region.x + region.width) / atlas.texture.width;
+    float v1 = (region.y + region.height) / atlas.texture.height;
+
+    float halfW = quad->size.x / 2;
+    float halfH = quad->size.y / 2;
+    float cosR = 1.0f;
+    float sinR = 0.0f;
+    if (quad->rotation != 0.0f) {
+        cosR = cosf(quad->rotation * DEG2RAD);
+        sinR = sinf(quad->rotation * DEG2RAD);
+    }
+
+    // Corner offsets rotated about the center
+    float ax = halfW * cosR, ay = halfW * sinR;
+    float bx = -halfH * sinR, by = halfH * cosR;
+    float x = quad->position.x;
+    float y = quad->position.y;
+
+    rlColor4ub(quad->tint.r, quad->tint.g, quad->tint.b, quad->tint.a);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+
+    rlTexCoord2f(u0, v0);
+    rlVertex2f(x - ax - bx, y - ay - by);
+    rlTexCoord2f(u0, v1);
+    rlVertex2f(x - ax + bx, y - ay + by);
+    rlTexCoord2f(u1, v1);
+    rlVertex2f(x + ax + bx, y + ay + by);
+    rlTexCoord2f(u1, v0);
+    rlVertex2f(x + ax - bx, y + ay - by);
+}
+
+// Sorts the queued sprites by layer and streams them to rlgl
+static void FlushSpriteBatch(void) {
+    int layerStart[SPRITE_LAYER_COUNT + 1] = { 0 };
+
+    // Counting sort keeps submission order within a layer
+    for (int i = 0; i < quadCount; i++) layerStart[quads[i].layer + 1]++;
+    for (int l = 0; l < SPRITE_LAYER_COUNT; l++) layerStart[l + 1] += layerStart[l];
+    for (int i = 0; i < quadCount; i++) quadOrder[layerStart[quads[i].layer]++] = i;
+
+    rlSetTexture(atlas.texture.id);
+    rlBegin(RL_QUADS);
+    for (int i = 0; i < quadCount; i++) {
+        // rlgl draws its buffer when full, the atlas has to be bound again after
+        if (rlCheckRenderBatchLimit(4)) {
+            rlSetTexture(atlas.texture.id);
+            rlBegin(RL_QUADS);
+            flushCount++;
+        }
+        EmitQuad(&quads[quadOrder[i]]);
+    }
+    rlEnd();
+    rlSetTexture(0);
+
+    lastSpriteCount += quadCount;
+    flushCount++;
+    quadCount = 0;
+}
+
+void DrawSprite(SpriteId sprite, SpriteLayer layer, Vector2 position, Vector2 size,
+                float rotation, Color tint) {
+    // Out of room, draw what we have and keep going
+    if (quadCount == SPRITE_BATCH_CAPACITY) FlushSpriteBatch();
+
+    quads[quadCount++] = (SpriteQuad){
+        .position = position,
+        .size = size,
+        .rotation = rotation,
+        .tint = tint,
+        .sprite = (unsigned char)sprite,
+        .layer = (unsigned char)layer
+    };
+}
+
+void DrawSpriteStream(SpriteId sprite, const float* x, const float* y, const float* size,
+                      const Color* tint, int count) {
+    if (count <= 0) return;
+
+    Rectangle region = atlas.regions[sprite];
+    float u0 = region.x / atlas.texture.width;
+    float v0 = region.y / atlas.texture.height;
+    float u1 = (region.x + region.width) / atlas.texture.width;
+    float v1 = (region.y + region.height) / atlas.texture.height;
+
+    rlSetTexture(atlas.texture.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    for (int i = 0; i < count; i++) {
+        if (rlCheckRenderBatchLimit(4)) {
+            rlSetTexture(atlas.texture.id);
+            rlBegin(RL_QUADS);
+            rlNormal3f(0.0f, 0.0f, 1.0f);
+            flushCount++;
+        }
+
+        float half = size[i] / 2;
+        rlColor4ub(tint[i].r, tint[i].g, tint[i].b, tint[i].a);
+        rlTexCoord2f(u0, v0);
+        rlVertex2f(x[i] - half, y[i] - half);
+        rlTexCoord2f(u0, v1);
+        rlVertex2f(x[i] - half, y[i] + half);
+        rlTexCoord2f(u1, v1);
+        rlVertex2f(x[i] + half, y[i] + half);
+        rlTexCoord2f(u1, v0);
+        rlVertex2f(x[i] + half, y[i] - half);
+    }
+    rlEnd();
+    rlSetTexture(0);
+
+    lastSpriteCount += count;
+    flushCount++;
+}
+
+void EndSpriteBatch(void) {
+    if (quadCount > 0) FlushSpriteBatch();
+    lastFlushCount = flushCount;
+}
+
+int GetSpriteBatchSpriteCount(void) {
+    return lastSpriteCount;
+}
+
+int GetSpriteBatchFlushCount(void) {
+    return lastFlushCount;
+}
@@ -0,0 +1,66 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "raylib.h"
+
+// All world sprites are packed into one atlas texture at startup and drawn
+// as a single stream of quads, so a frame costs a handful of draw calls no
+// matter how many entities are on screen. Sprites are queued between
+// BeginSpriteBatch and EndSpriteBatch and submitted sorted by layer.
+
+#ifndef SPRITE_BATCH_CAPACITY
+#define SPRITE_BATCH_CAPACITY 8192
+#endif
+
+#define ATLAS_WIDTH 1024
+#define ATLAS_MAX_SPRITE_SIZE 256  // Larger images are scaled down to fit
+#define ATLAS_PADDING 2
+
+typedef enum {
+    SPRITE_SHIP,
+    SPRITE_GOLD,
+    SPRITE_ASTEROID,
+    SPRITE_JET,
+    SPRITE_BEAM,
+    SPRITE_STATION,
+    SPRITE_AI_SHIP,
+    SPRITE_WHITE,   // Solid texel for bars and rectangles
+    SPRITE_CIRCLE,  // Filled circle for round projectiles
+    SPRITE_COUNT
+} SpriteId;
+
+// Drawn back to front, sprites within a layer keep their submission order
+typedef enum {
+    SPRITE_LAYER_PLAYER,
+    SPRITE_LAYER_COINS,
+    SPRITE_LAYER_ASTEROIDS,
+    SPRITE_LAYER_BEAMS,
+    SPRITE_LAYER_STATIONS,
+    SPRITE_LAYER_ENEMIES,
+    SPRITE_LAYER_OVERLAY,
+    SPRITE_LAYER_COUNT
+} SpriteLayer;
+
+// Queues the sprite images with the asset cache, so they can decode while
+// a loading screen runs. LoadSpriteAtlas requests whatever is missing and
+// waits for it, then packs the atlas on the main thread.
+void RequestSpriteAtlas(void);
+bool LoadSpriteAtlas(void);
+void UnloadSpriteAtlas(void);
+
+void BeginSpriteBatch(void);
+// Queues a sprite centered on position, rotated in degrees about its center
+void DrawSprite(SpriteId sprite, SpriteLayer layer, Vector2 position, Vector2 size,
+                float rotation, Color tint);
+void EndSpriteBatch(void);
+// Draws count unrotated copies of one sprite straight away, skipping the
+// queue and the layer sort. Meant for thousands of small things such as
+// particles, which end up under anything still queued in the batch.
+void DrawSpriteStream(SpriteId sprite, const float* x, const float* y, const float* size,
+                      const Color* tint, int count);
+
+// Sprites and atlas flushes submitted by the last EndSpriteBatch
+int GetSpriteBatchSpriteCount(void);
+int GetSpriteBatchFlushCount(void);
+
+#endif // SPRITE_BATCH_H
@@ -0,0 +1,161 @@
+#include "starfield.h"
+#include <math.h>
+#include "rlgl.h"
+
+// How each layer looks, far to near. Cell size and star size are in
+// pixels, parallax is the share of the camera movement the layer follows.
+typedef struct {
+    float parallax;
+    float cellSize;
+    float density;   // Share of cells holding a star
+    float starSize;  // Radius of the bright core
+    float twinkle;   // How far brightness dips, 0 keeps stars steady
+    Color tint;
+} StarLayer;
+
+static const StarLayer layers[STARFIELD_LAYERS] = {
+    { .parallax = 0.1f, .cellSize = 40,  .density = 0.35f, .starSize = 0.8f, .twinkle = 0.3f,
+      .tint = { 160, 180, 255, 170 } },
+    { .parallax = 0.3f, .cellSize = 90,  .density = 0.3f,  .starSize = 1.3f, .twinkle = 0.2f,
+      .tint = { 215, 220, 255, 220 } },
+    { .parallax = 0.6f, .cellSize = 170, .density = 0.25f, .starSize = 2.0f, .twinkle = 0.1f,
+      .tint = { 255, 245, 225, 255 } }
+};
+
+// Passes the screen position on, the quad is drawn in screen space
+static const char* vertexShader =
+    "#version 330\n"
+    "in vec3 vertexPosition;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 screenPos;\n"
+    "void main() {\n"
+    "    screenPos = vertexPosition.xy;\n"
+    "    gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+    "}\n";
+
+// The scroll comes in as whole cells plus the rest, so the hash sees exact
+// cell numbers however far the camera has flown
+static const char* fragmentShader =
+    "#version 330\n"
+    "in vec2 screenPos;\n"
+    "uniform ivec2 cellOffset;\n"
+    "uniform vec2 cellFraction;\n"
+    "uniform float cellSize;\n"
+    "uniform float density;\n"
+    "uniform float starSize;\n"
+    "uniform float twinkle;\n"
+    "uniform vec4 tint;\n"
+    "uniform int seed;\n"
+    "uniform float time;\n"
+    "out vec4 finalColor;\n"
+    "uint Hash(uint x) {\n"
+    "    x ^= x >> 16; x *= 0x7feb352du;\n"
+    "    x ^= x >> 15; x *= 0x846ca68bu;\n"
+    "    return x ^ (x >> 16);\n"
+    "}\n"
+    "float Unit(uint h) { return float(h >> 8) / 16777216.0; }\n"
+    "void main() {\n"
+    "    vec2 p = screenPos + cellFraction;\n"
+    "    vec2 cellPos = floor(p / cellSize);\n"
+    "    vec2 local = p - cellPos * cellSize;\n"
+    "    ivec2 cell = ivec2(cellPos) + cellOffset;\n"
+    "    uint h = Hash(uint(cell.x) ^ Hash(uint(cell.y) ^ uint(seed)));\n"
+    "    if (Unit(h) >= density) discard;\n"
+    "    uint hx = Hash(h);\n"
+    "    uint hy = Hash(hx);\n"
+    "    uint hb = Hash(hy);\n"
+    // Kept clear of the cell edge so no glow is cut off by the next cell
+    "    float margin = starSize * 3.0;\n"
+    "    vec2 star = margin + vec2(Unit(hx), Unit(hy)) * (cellSize - 2.0 * margin);\n"
+    "    float glow = clamp(1.0 - length(local - star) / margin, 0.0, 1.0);\n"
+    "    if (glow <= 0.0) discard;\n"
+    "    float brightness = 0.4 + 0.6 * Unit(hb);\n"
+    "    float phase = 6.2831853 * Unit(hb ^ hx);\n"
+    "    float speed = 1.0 + 3.0 * Unit(hb ^ hy);\n"
+    "    brightness *= 1.0 - twinkle * (0.5 + 0.5 * sin(time * speed + phase));\n"
+    "    finalColor = vec4(tint.rgb, tint.a * glow * glow * brightness);\n"
+    "}\n";
+
+typedef enum {
+    UNIFORM_CELL_OFFSET,
+    UNIFORM_CELL_FRACTION,
+    UNIFORM_CELL_SIZE,
+    UNIFORM_DENSITY,
+    UNIFORM_STAR_SIZE,
+    UNIFORM_TWINKLE,
+    UNIFORM_TINT,
+    UNIFORM_SEED,
+    UNIFORM_TIME,
+    UNIFORM_COUNT
+} StarfieldUniform;
+
+static const char* uniformNames[UNIFORM_COUNT] = {
+    [UNIFORM_CELL_OFFSET] = "cellOffset",
+    [UNIFORM_CELL_FRACTION] = "cellFraction",
+    [UNIFORM_CELL_SIZE] = "cellSize",
+    [UNIFORM_DENSITY] = "density",
+    [UNIFORM_STAR_SIZE] = "starSize",
+    [UNIFORM_TWINKLE] = "twinkle",
+    [UNIFORM_TINT] = "tint",
+    [UNIFORM_SEED] = "seed",
+    [UNIFORM_TIME] = "time"
+};
+
+static Shader shader = { 0 };
+static int uniforms[UNIFORM_COUNT];
+static bool loaded = false;
+
+void LoadStarfield(void) {
+    UnloadStarfield();
+    shader = LoadShaderFromMemory(vertexShader, fragmentShader);
+
+    // raylib hands back its default shader when compiling fails, drawing
+    // with that would cover the screen in white
+    if (shader.id == 0 || shader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "STARFIELD: Shader did not compile, drawing no background");
+        return;
+    }
+    for (int u = 0; u < UNIFORM_COUNT; u++) {
+        uniforms[u] = GetShaderLocation(shader, uniformNames[u]);
+    }
+    loaded = true;
+}
+
+void UnloadStarfield(void) {
+    if (loaded) UnloadShader(shader);
+    shader = (Shader){ 0 };
+    loaded = false;
+}
+
+void DrawStarfield(Vector2 cameraTarget) {
+    if (!loaded) return;
+
+    float time = (float)GetTime();
+    for (int l = 0; l < STARFIELD_LAYERS; l++) {
+        const StarLayer* layer = &layers[l];
+        float scrollX = cameraTarget.x * layer->parallax;
+        float scrollY = cameraTarget.y * layer->parallax;
+        float cellX = floorf(scrollX / layer->cellSize);
+        float cellY = floorf(scrollY / layer->cellSize);
+        int cellOffset[2] = { (int)cellX, (int)cellY };
+        float cellFraction[2] = { scrollX - cellX * layer->cellSize, scrollY - cellY * layer->cellSize };
+        float tint[4] = { layer->tint.r / 255.0f, layer->tint.g / 255.0f, layer->tint.b / 255.0f, layer->tint.a / 255.0f };
+        int seed = (l + 1) * 0x9e37;
+
+        SetShaderValue(shader, uniforms[UNIFORM_CELL_OFFSET], cellOffset, SHADER_UNIFORM_IVEC2);
+        SetShaderValue(shader, uniforms[UNIFORM_CELL_FRACTION], cellFraction, SHADER_UNIFORM_VEC2);
+        SetShaderValue(shader, uniforms[UNIFORM_CELL_SIZE], &layer->cellSize, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(shader, uniforms[UNIFORM_DENSITY], &layer->density, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(shader, uniforms[UNIFORM_STAR_SIZE], &layer->starSize, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(shader, uniforms[UNIFORM_TWINKLE], &layer->twinkle, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(shader, uniforms[UNIFORM_TINT], tint, SHADER_UNIFORM_VEC4);
+        SetShaderValue(shader, uniforms[UNIFORM_SEED], &seed, SHADER_UNIFORM_INT);
+        SetShaderValue(shader, uniforms[UNIFORM_TIME], &time, SHADER_UNIFORM_FLOAT);
+
+        // Uniforms only change between draws, so every layer is its own
+        // shader mode and with that its own draw call
+        BeginShaderMode(shader);
+        DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), WHITE);
+        EndShaderMode();
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef STARFIELD_H
+#define STARFIELD_H
+
+#include "raylib.h"
+
+// Procedural parallax background for the frontend. Stars are not stored
+// anywhere: a shader hashes the cell under each pixel to decide whether it
+// holds a star and where, so the field costs no texture memory and covers
+// any resolution. Each layer is one full screen quad scrolling at its own
+// fraction of the camera speed.
+
+#define STARFIELD_LAYERS 3
+
+void LoadStarfield(void);
+void UnloadStarfield(void);
+// Fills the screen with every layer, far ones first. Call outside
+// BeginMode2D, the layers are drawn in screen space.
+void DrawStarfield(Vector2 cameraTarget);
+
+#endif // STARFIELD_H
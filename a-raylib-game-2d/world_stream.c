@@ -0,0 +1,564 @@
+#include "world_stream.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rng.h"
+#include "poisson_disk.h"
+
+#define CHUNK_ITEM_WORDS ((CHUNK_MAX_ITEMS + 31) / 32)
+
+// Generated chunks. The generator thread only touches a slot while it is
+// GENERATING, the main thread only reads it once it is READY.
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_GENERATING,
+    SLOT_READY
+} ChunkSlotState;
+
+typedef struct {
+    ChunkSlotState state;
+    ChunkCoord coord;    // Kept apart from contents, which the generator writes unlocked
+    unsigned int order;  // Queued slots are generated oldest request first
+    ChunkContents contents;
+} ChunkSlot;
+
+// What happened to the items of one chunk, a bit per item
+typedef struct {
+    ChunkCoord coord;
+    bool used;
+    int spawnedCount;
+    unsigned int lastUsed;
+    uint32_t consumed[CHUNK_ITEM_WORDS];  // Collected or destroyed
+    uint32_t spawned[CHUNK_ITEM_WORDS];   // Currently out in the world
+} ChunkRecord;
+
+// A changed chunk pushed out of the record table. Nothing of it is out in
+// the world by then, so the used up items are all there is to keep.
+typedef struct {
+    ChunkCoord coord;
+    uint32_t consumed[CHUNK_ITEM_WORDS];
+} StoredChunk;
+
+static ChunkSlot slots[CHUNK_CACHE_SLOTS];
+static ChunkContents fallbackContents;  // Only used if every slot is taken
+// Scratch for spacing out asteroids, one per thread that generates chunks
+static PoissonDisk streamSampler;
+static PoissonDisk mainSampler;
+static unsigned int requestOrder = 0;
+
+static ChunkRecord records[CHUNK_RECORD_CAPACITY];
+// Sorted by coordinate, searched when a chunk gets a record again
+static StoredChunk storedChunks[CHUNK_STORE_CAPACITY];
+static int storedCount = 0;
+// One window per player, only the first windowCount can be open
+static ChunkCoord windowCenters[MAX_PLAYERS];
+static bool windowOpen[MAX_PLAYERS];
+static int windowCount = 0;
+static unsigned int windowMoves = 0;
+
+static unsigned int worldSeed;
+static int asteroidsPerChunk;
+static int coinsPerChunk;
+static WorldStreamStats stats;
+
+static pthread_t thread;
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t doneCond = PTHREAD_COND_INITIALIZER;
+static bool running = false;
+static bool quitting = false;
+
+static int ClampCount(int count, int max) {
+    if (count < 0) return 0;
+    return count > max ? max : count;
+}
+
+static ChunkCoord GetChunkCoord(Vector2 position) {
+    return (ChunkCoord){
+        (int)floorf(position.x / CHUNK_SIZE),
+        (int)floorf(position.y / CHUNK_SIZE)
+    };
+}
+
+// Chebyshev distance in chunks
+static int ChunkDistance(ChunkCoord a, ChunkCoord b) {
+    int dx = abs(a.x - b.x);
+    int dy = abs(a.y - b.y);
+    return dx > dy ? dx : dy;
+}
+
+static bool SameChunk(ChunkCoord a, ChunkCoord b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// True if an open window other than skip is centered within radius chunks
+static bool IsNearWindow(ChunkCoord coord, int radius, int skip) {
+    for (int w = 0; w < windowCount; w++) {
+        if (w != skip && windowOpen[w] && ChunkDistance(coord, windowCenters[w]) <= radius) return true;
+    }
+    return false;
+}
+
+// SplitMix64 over the world seed and the coordinates, neighbouring chunks
+// get unrelated streams
+static uint64_t GetChunkSeed(ChunkCoord coord) {
+    uint64_t z = ((uint64_t)worldSeed << 32) ^
+                 ((uint64_t)(uint32_t)coord.x << 16) ^
+                 ((uint64_t)(uint32_t)coord.y * 0x9e3779b97f4a7c15ULL);
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static ChunkItem GenerateCoin(RandomStream* rng, ChunkCoord coord) {
+    return (ChunkItem){
+        .x = (coord.x + GetRandomStreamFloat(rng)) * CHUNK_SIZE,
+        .y = (coord.y + GetRandomStreamFloat(rng)) * CHUNK_SIZE,
+        .velX = GetRandomStreamValue(rng, -COIN_SPEED, COIN_SPEED) * SIM_TICK_SCALE,
+        .velY = GetRandomStreamValue(rng, -COIN_SPEED, COIN_SPEED) * SIM_TICK_SCALE,
+        .size = COIN_SIZE
+    };
+}
+
+// Asteroids are spread with Poisson-disk sampling so none start on top of
+// each other or the station. The area is inset by half the minimum spacing,
+// which keeps asteroids in neighbouring chunks apart as well.
+static void PlaceAsteroids(ChunkContents* chunk, RandomStream* rng, PoissonDisk* sampler) {
+    chunk->asteroidCount = 0;
+    if (asteroidsPerChunk == 0) return;
+
+    float inset = CHUNK_ASTEROID_SPACING / 2.0f;
+    Rectangle area = {
+        chunk->coord.x * (float)CHUNK_SIZE + inset,
+        chunk->coord.y * (float)CHUNK_SIZE + inset,
+        CHUNK_SIZE - 2 * inset,
+        CHUNK_SIZE - 2 * inset
+    };
+
+    // Sparse chunks space their asteroids further apart, a fill at this
+    // spacing holds a few times the count and picking from it stays cheap
+    float spacing = sqrtf(area.width * area.height / (CHUNK_ASTEROID_OVERFILL * asteroidsPerChunk));
+    if (spacing < CHUNK_ASTEROID_SPACING) spacing = CHUNK_ASTEROID_SPACING;
+
+    int sampled = SamplePoissonDisk(sampler, rng, area, spacing);
+    ShufflePoissonDisk(sampler, rng, sampled);
+
+    float stationClearance = chunk->station.size/2 + CHUNK_ASTEROID_SPACING;
+    for (int n = 0; n < sampled && chunk->asteroidCount < asteroidsPerChunk; n++) {
+        Vector2 point = sampler->points[n];
+        if (chunk->hasStation) {
+            float dx = point.x - chunk->station.x;
+            float dy = point.y - chunk->station.y;
+            if (dx*dx + dy*dy < stationClearance * stationClearance) continue;
+        }
+
+        chunk->asteroids[chunk->asteroidCount++] = (ChunkItem){
+            .x = point.x,
+            .y = point.y,
+            .velX = GetRandomStreamValue(rng, -ASTEROID_SPEED, ASTEROID_SPEED) * SIM_TICK_SCALE,
+            .velY = GetRandomStreamValue(rng, -ASTEROID_SPEED, ASTEROID_SPEED) * SIM_TICK_SCALE,
+            .size = GetRandomStreamValue(rng, ASTEROID_MIN_SIZE, ASTEROID_MAX_SIZE)
+        };
+    }
+}
+
+// Pure function of the seed and coordinates, safe to run on any thread as
+// long as each thread brings its own sampler
+static void GenerateChunk(ChunkContents* chunk, ChunkCoord coord, PoissonDisk* sampler) {
+    RandomStream rng;
+    SeedRandomStream(&rng, GetChunkSeed(coord));
+    chunk->coord = coord;
+
+    // Stations stay near the middle of their chunk, which keeps stations in
+    // neighbouring chunks at least MIN_STATION_DISTANCE apart
+    chunk->hasStation = GetRandomStreamValue(&rng, 0, 99) < CHUNK_STATION_CHANCE;
+    chunk->station = (ChunkItem){ 0 };
+    if (chunk->hasStation) {
+        float jitter = (CHUNK_SIZE - MIN_STATION_DISTANCE) / 2.0f;
+        chunk->station = (ChunkItem){
+            .x = (coord.x + 0.5f) * CHUNK_SIZE + (GetRandomStreamFloat(&rng) * 2 - 1) * jitter,
+            .y = (coord.y + 0.5f) * CHUNK_SIZE + (GetRandomStreamFloat(&rng) * 2 - 1) * jitter,
+            .size = GetRandomStreamValue(&rng, STATION_MIN_SIZE, STATION_MAX_SIZE)
+        };
+    }
+
+    PlaceAsteroids(chunk, &rng, sampler);
+
+    chunk->coinCount = coinsPerChunk;
+    for (int k = 0; k < chunk->coinCount; k++) {
+        chunk->coins[k] = GenerateCoin(&rng, coord);
+    }
+}
+
+static int NextQueuedSlot(void) {
+    int next = -1;
+    for (int s = 0; s < CHUNK_CACHE_SLOTS; s++) {
+        if (slots[s].state != SLOT_QUEUED) continue;
+        if (next < 0 || slots[s].order < slots[next].order) next = s;
+    }
+    return next;
+}
+
+static void* StreamMain(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&streamLock);
+    while (!quitting) {
+        int s = NextQueuedSlot();
+        if (s < 0) {
+            pthread_cond_wait(&workCond, &streamLock);
+            continue;
+        }
+
+        slots[s].state = SLOT_GENERATING;
+        ChunkCoord coord = slots[s].coord;
+        pthread_mutex_unlock(&streamLock);
+
+        GenerateChunk(&slots[s].contents, coord, &streamSampler);
+
+        pthread_mutex_lock(&streamLock);
+        slots[s].state = SLOT_READY;
+        pthread_cond_broadcast(&doneCond);
+    }
+    pthread_mutex_unlock(&streamLock);
+    return NULL;
+}
+
+void InitWorldStream(unsigned int seed, int asteroids, int coins) {
+    ShutdownWorldStream();
+
+    worldSeed = seed;
+    asteroidsPerChunk = ClampCount(asteroids, CHUNK_MAX_ASTEROIDS);
+    coinsPerChunk = ClampCount(coins, CHUNK_MAX_COINS);
+    stats = (WorldStreamStats){ 0 };
+    for (int s = 0; s < CHUNK_CACHE_SLOTS; s++) {
+        slots[s].state = SLOT_FREE;
+    }
+    ResetWorldStream();
+
+    int cells = GetPoissonDiskCellCount(CHUNK_SIZE, CHUNK_SIZE, CHUNK_ASTEROID_SPACING);
+    InitPoissonDisk(&streamSampler, cells);
+    InitPoissonDisk(&mainSampler, cells);
+
+    // Without the thread every chunk is simply generated when it is needed
+    quitting = false;
+    running = pthread_create(&thread, NULL, StreamMain, NULL) == 0;
+}
+
+void ShutdownWorldStream(void) {
+    if (running) {
+        pthread_mutex_lock(&streamLock);
+        quitting = true;
+        pthread_cond_broadcast(&workCond);
+        pthread_mutex_unlock(&streamLock);
+
+        pthread_join(thread, NULL);
+        running = false;
+    }
+
+    UnloadPoissonDisk(&streamSampler);
+    UnloadPoissonDisk(&mainSampler);
+}
+
+void ResetWorldStream(void) {
+    for (int r = 0; r < CHUNK_RECORD_CAPACITY; r++) {
+        records[r].used = false;
+    }
+    stats.records = 0;
+    storedCount = 0;
+    stats.storedChunks = 0;
+    for (int w = 0; w < MAX_PLAYERS; w++) {
+        windowOpen[w] = false;
+    }
+    windowCount = 0;
+}
+
+static int FindSlot(ChunkCoord coord) {
+    for (int s = 0; s < CHUNK_CACHE_SLOTS; s++) {
+        if (slots[s].state != SLOT_FREE && SameChunk(slots[s].coord, coord)) return s;
+    }
+    return -1;
+}
+
+static int FindFreeSlot(void) {
+    for (int s = 0; s < CHUNK_CACHE_SLOTS; s++) {
+        if (slots[s].state == SLOT_FREE) return s;
+    }
+    return -1;
+}
+
+// Called with streamLock held
+static void RequestChunk(ChunkCoord coord) {
+    if (FindSlot(coord) >= 0) return;
+
+    int s = FindFreeSlot();
+    if (s < 0) return;  // Generated on demand instead
+
+    slots[s].coord = coord;
+    slots[s].order = requestOrder++;
+    slots[s].state = SLOT_QUEUED;
+}
+
+static bool HasChanges(const ChunkRecord* record) {
+    if (record->spawnedCount > 0) return true;
+    for (int w = 0; w < CHUNK_ITEM_WORDS; w++) {
+        if (record->consumed[w] != 0) return true;
+    }
+    return false;
+}
+
+int UpdateWorldWindow(int window, Vector2 position, ChunkCoord* entered, int maxEntered) {
+    ChunkCoord player = GetChunkCoord(position);
+
+    // The player's chunk and its neighbours must stay loaded, anything
+    // short of that leaves the window where it is
+    if (windowOpen[window] && ChunkDistance(player, windowCenters[window]) < CHUNK_LOAD_RADIUS) return 0;
+
+    ChunkCoord previous = windowCenters[window];
+    bool hadWindow = windowOpen[window];
+    windowCenters[window] = player;
+    windowOpen[window] = true;
+    if (window >= windowCount) windowCount = window + 1;
+    windowMoves++;
+
+    int count = 0;
+    for (int dy = -CHUNK_LOAD_RADIUS; dy <= CHUNK_LOAD_RADIUS; dy++) {
+        for (int dx = -CHUNK_LOAD_RADIUS; dx <= CHUNK_LOAD_RADIUS; dx++) {
+            ChunkCoord coord = { player.x + dx, player.y + dy };
+            if (hadWindow && ChunkDistance(coord, previous) <= CHUNK_LOAD_RADIUS) continue;
+            if (IsNearWindow(coord, CHUNK_LOAD_RADIUS, window)) continue;  // Already loaded
+            if (count < maxEntered) entered[count++] = coord;
+        }
+    }
+
+    // Records with nothing to remember are dropped once out of every window
+    for (int r = 0; r < CHUNK_RECORD_CAPACITY; r++) {
+        ChunkRecord* record = &records[r];
+        if (!record->used || IsNearWindow(record->coord, CHUNK_LOAD_RADIUS, -1)) continue;
+        if (!HasChanges(record)) {
+            record->used = false;
+            stats.records--;
+        }
+    }
+
+    pthread_mutex_lock(&streamLock);
+
+    // Drop generated chunks every player has left behind
+    for (int s = 0; s < CHUNK_CACHE_SLOTS; s++) {
+        ChunkSlot* slot = &slots[s];
+        if (slot->state != SLOT_QUEUED && slot->state != SLOT_READY) continue;
+        if (!IsNearWindow(slot->coord, CHUNK_PREFETCH_RADIUS, -1)) {
+            slot->state = SLOT_FREE;
+        }
+    }
+
+    // Queue the chunks that just entered first, then the ring around them
+    for (int n = 0; n < count; n++) {
+        RequestChunk(entered[n]);
+    }
+    for (int dy = -CHUNK_PREFETCH_RADIUS; dy <= CHUNK_PREFETCH_RADIUS; dy++) {
+        for (int dx = -CHUNK_PREFETCH_RADIUS; dx <= CHUNK_PREFETCH_RADIUS; dx++) {
+            RequestChunk((ChunkCoord){ player.x + dx, player.y + dy });
+        }
+    }
+
+    pthread_cond_signal(&workCond);
+    pthread_mutex_unlock(&streamLock);
+
+    return count;
+}
+
+void CloseWorldWindow(int window) {
+    windowOpen[window] = false;
+    while (windowCount > 0 && !windowOpen[windowCount - 1]) windowCount--;
+}
+
+bool IsInWorldWindow(Vector2 position) {
+    return IsNearWindow(GetChunkCoord(position), CHUNK_LOAD_RADIUS, -1);
+}
+
+const ChunkContents* AcquireChunk(ChunkCoord coord) {
+    stats.chunksLoaded++;
+
+    pthread_mutex_lock(&streamLock);
+    int s = FindSlot(coord);
+    if (s < 0) {
+        pthread_mutex_unlock(&streamLock);
+        GenerateChunk(&fallbackContents, coord, &mainSampler);
+        stats.stalls++;
+        return &fallbackContents;
+    }
+
+    ChunkSlot* slot = &slots[s];
+    if (slot->state == SLOT_READY) {
+        stats.prefetchHits++;
+    } else if (slot->state == SLOT_QUEUED) {
+        // Not started yet, quicker to do it here than to wait in line
+        slot->state = SLOT_GENERATING;
+        pthread_mutex_unlock(&streamLock);
+        GenerateChunk(&slot->contents, coord, &mainSampler);
+        pthread_mutex_lock(&streamLock);
+        slot->state = SLOT_READY;
+        stats.stalls++;
+    } else {
+        while (slot->state != SLOT_READY) {
+            pthread_cond_wait(&doneCond, &streamLock);
+        }
+        stats.stalls++;
+    }
+    pthread_mutex_unlock(&streamLock);
+
+    return &slot->contents;
+}
+
+// Row by row, the order the store is sorted in
+static bool IsChunkBefore(ChunkCoord a, ChunkCoord b) {
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+// First stored chunk that is not before coord
+static int FindStoredChunk(ChunkCoord coord) {
+    int low = 0;
+    int high = storedCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (IsChunkBefore(storedChunks[mid].coord, coord)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// False if the store is full
+static bool StoreChunk(ChunkCoord coord, const uint32_t* consumed) {
+    if (storedCount >= CHUNK_STORE_CAPACITY) return false;
+
+    int s = FindStoredChunk(coord);
+    memmove(&storedChunks[s + 1], &storedChunks[s], (storedCount - s) * sizeof(StoredChunk));
+    storedChunks[s].coord = coord;
+    memcpy(storedChunks[s].consumed, consumed, sizeof(storedChunks[s].consumed));
+    storedCount++;
+    stats.storedChunks = storedCount;
+    return true;
+}
+
+// Moves the stored changes of the chunk out of the store, false if it has none
+static bool TakeStoredChunk(ChunkCoord coord, uint32_t* consumed) {
+    int s = FindStoredChunk(coord);
+    if (s == storedCount || !SameChunk(storedChunks[s].coord, coord)) return false;
+
+    memcpy(consumed, storedChunks[s].consumed, sizeof(storedChunks[s].consumed));
+    memmove(&storedChunks[s], &storedChunks[s + 1], (storedCount - s - 1) * sizeof(StoredChunk));
+    storedCount--;
+    stats.storedChunks = storedCount;
+    return true;
+}
+
+int GetChunkRecord(ChunkCoord coord) {
+    int freeRecord = -1;
+    int oldestUnchanged = -1;
+    int oldestChanged = -1;
+    for (int r = 0; r < CHUNK_RECORD_CAPACITY; r++) {
+        ChunkRecord* record = &records[r];
+        if (!record->used) {
+            if (freeRecord < 0) freeRecord = r;
+            continue;
+        }
+        if (SameChunk(record->coord, coord)) {
+            record->lastUsed = windowMoves;
+            return r;
+        }
+
+        // Far away chunks with nothing out in the world can give up their
+        // record. Unchanged ones come back as freshly generated, changed
+        // ones are only taken once their changes are in the store.
+        if (record->spawnedCount > 0 || IsNearWindow(record->coord, CHUNK_LOAD_RADIUS, -1)) continue;
+        int* oldest = HasChanges(record) ? &oldestChanged : &oldestUnchanged;
+        if (*oldest < 0 || record->lastUsed < records[*oldest].lastUsed) {
+            *oldest = r;
+        }
+    }
+
+    // Taken out first, so a chunk coming back from a full store makes room
+    // for the one that gives up its record
+    uint32_t consumed[CHUNK_ITEM_WORDS] = { 0 };
+    bool stored = TakeStoredChunk(coord, consumed);
+
+    int r = freeRecord >= 0 ? freeRecord : oldestUnchanged;
+    if (r < 0 && oldestChanged >= 0 &&
+        StoreChunk(records[oldestChanged].coord, records[oldestChanged].consumed)) {
+        r = oldestChanged;
+    }
+    if (r < 0) {
+        if (stored) StoreChunk(coord, consumed);
+        return -1;
+    }
+
+    if (freeRecord >= 0) stats.records++;
+    records[r] = (ChunkRecord){
+        .coord = coord,
+        .used = true,
+        .lastUsed = windowMoves
+    };
+    memcpy(records[r].consumed, consumed, sizeof(consumed));
+    return r;
+}
+
+static bool TestBit(const uint32_t* bits, int item) {
+    return (bits[item >> 5] >> (item & 31)) & 1u;
+}
+
+bool IsChunkItemAvailable(int record, int item) {
+    const ChunkRecord* chunk = &records[record];
+    return !TestBit(chunk->consumed, item) && !TestBit(chunk->spawned, item);
+}
+
+void MarkChunkItemSpawned(int record, int item) {
+    ChunkRecord* chunk = &records[record];
+    if (TestBit(chunk->spawned, item)) return;
+
+    chunk->spawned[item >> 5] |= 1u << (item & 31);
+    chunk->spawnedCount++;
+}
+
+void ReleaseChunkItem(int record, int item) {
+    ChunkRecord* chunk = &records[record];
+    if (!TestBit(chunk->spawned, item)) return;
+
+    chunk->spawned[item >> 5] &= ~(1u << (item & 31));
+    chunk->spawnedCount--;
+}
+
+void ConsumeChunkItem(int record, int item) {
+    ReleaseChunkItem(record, item);
+    records[record].consumed[item >> 5] |= 1u << (item & 31);
+}
+
+int GetWorldStreamStateRegions(StateRegion* regions, int maxRegions) {
+    // Generated chunks are a cache, they come out the same from the seed
+    StateRegion own[] = {
+        { records, sizeof(records) },
+        { storedChunks, sizeof(storedChunks) },
+        { &storedCount, sizeof(storedCount) },
+        { windowCenters, sizeof(windowCenters) },
+        { windowOpen, sizeof(windowOpen) },
+        { &windowCount, sizeof(windowCount) },
+        { &windowMoves, sizeof(windowMoves) },
+        { &stats, sizeof(stats) }
+    };
+    int count = sizeof(own) / sizeof(own[0]);
+    if (count > maxRegions) return -1;
+    for (int r = 0; r < count; r++) {
+        regions[r] = own[r];
+    }
+    return count;
+}
+
+WorldStreamStats GetWorldStreamStats(void) {
+    return stats;
+}
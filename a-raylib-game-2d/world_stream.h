@@ -0,0 +1,93 @@
+#ifndef WORLD_STREAM_H
+#define WORLD_STREAM_H
+
+#include "raylib.h"
+#include "game_defs.h"
+#include "snapshot.h"
+
+// Streams an endless world in square chunks. Every chunk is generated from
+// a seed derived from the world seed and its coordinates, so it always
+// comes back the same. A window of loaded chunks follows every player, and
+// a background thread generates the ring just outside them before it is
+// needed. A chunk stays loaded while any window holds it.
+// The only state kept for chunks that leave the window is a bit per item
+// that was used up, which keeps memory bounded however far the player goes.
+// Once the record table is full, changed chunks move to a compact store of
+// just those bits and get them back when they load again.
+
+// Item numbers inside a chunk, used to remember what happened to each one
+#define CHUNK_ASTEROID_ITEM(k) (k)
+#define CHUNK_COIN_ITEM(k) (CHUNK_MAX_ASTEROIDS + (k))
+#define CHUNK_STATION_ITEM (CHUNK_MAX_ASTEROIDS + CHUNK_MAX_COINS)
+#define CHUNK_MAX_ITEMS (CHUNK_STATION_ITEM + 1)
+
+typedef struct {
+    int x;
+    int y;
+} ChunkCoord;
+
+typedef struct {
+    float x;
+    float y;
+    float velX;
+    float velY;
+    float size;
+} ChunkItem;
+
+// Everything a chunk starts out with
+typedef struct {
+    ChunkCoord coord;
+    int asteroidCount;
+    int coinCount;
+    bool hasStation;
+    ChunkItem asteroids[CHUNK_MAX_ASTEROIDS];
+    ChunkItem coins[CHUNK_MAX_COINS];
+    ChunkItem station;
+} ChunkContents;
+
+typedef struct {
+    long long chunksLoaded;   // Chunks that entered the window
+    long long prefetchHits;   // ... and were already generated in the background
+    long long stalls;         // ... and had to be generated or waited for
+    int records;              // Chunks with remembered changes or items out in the world
+    int storedChunks;         // Changed chunks moved out of the records to the compact store
+} WorldStreamStats;
+
+// Starts the generator thread, counts are clamped to the chunk limits and
+// crowded chunks hold fewer asteroids when no more fit CHUNK_ASTEROID_SPACING apart
+void InitWorldStream(unsigned int seed, int asteroidsPerChunk, int coinsPerChunk);
+void ShutdownWorldStream(void);
+// Forgets every change and empties the windows, generated chunks are kept
+void ResetWorldStream(void);
+
+// Recenters a player's window once the player's chunk gets too close to
+// its edge, window is the player's index. Writes the chunks that entered
+// and were not loaded by another window yet, and returns how many.
+int UpdateWorldWindow(int window, Vector2 position, ChunkCoord* entered, int maxEntered);
+// The player left, its chunks unload unless another window holds them
+void CloseWorldWindow(int window);
+// True if any window holds the position
+bool IsInWorldWindow(Vector2 position);
+
+// Contents of a chunk in the window, waits for it if the background thread
+// is still busy with it. Valid until the next AcquireChunk or UpdateWorldWindow.
+const ChunkContents* AcquireChunk(ChunkCoord coord);
+
+// Record of a chunk in the window, or -1 when every record is in use and
+// the store has no room left for the changes of the oldest one
+int GetChunkRecord(ChunkCoord coord);
+// True if the item is neither used up nor already out in the world
+bool IsChunkItemAvailable(int record, int item);
+void MarkChunkItemSpawned(int record, int item);
+// The item left the window, it comes back home when its chunk loads again
+void ReleaseChunkItem(int record, int item);
+// The item was collected or destroyed and never comes back
+void ConsumeChunkItem(int record, int item);
+
+WorldStreamStats GetWorldStreamStats(void);
+
+// Memory holding what happened to the world, for snapshots. Returns how
+// many regions were written, or -1 if maxRegions is too small.
+int GetWorldStreamStateRegions(StateRegion* regions, int maxRegions);
+
+#endif // WORLD_STREAM_H